@@ -0,0 +1,323 @@
+/**
+ * @file backend_load.cpp
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief epoll/io_uring 빌드의 서버에 같은 부하를 주고 처리량과 지연 시간을
+ * 측정하는 부하 생성기
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <asio.hpp>
+
+//* 사용법
+//*   bench_backend_load <olc|line|chat> <host> <port> <connections> <seconds>
+//*     [threads] [label]
+//*
+//* olc : olc_simple_server에 ServerPing을 보내고 되돌아오는 메세지를 기다린다.
+//* line: asio4_async_parallel_tcp_server에 한 연결 (keep-alive)로 한 줄 요청과
+//*       응답을 반복한다. 서버가 거절하거나 버린 요청 (Busy)은 따로 세고,
+//*       그 연결은 끊고 새로 연결한다.
+//* chat: dens_simple_chat_server에 한 줄을 보내고 자신의 줄이 브로드캐스트되어
+//*       돌아올 때까지 기다린다.
+//*
+//* 각 연결은 응답을 받은 후 다음 요청을 보내는 closed-loop로 동작한다.
+
+using Clock = std::chrono::steady_clock;
+
+enum class Protocol { olc, line, chat };
+
+// simple_server.cpp의 CustomMsgTypes::ServerPing과 같은 값
+constexpr uint32_t OLC_SERVER_PING = 2;
+
+// olc::net::message_header와 같은 배치
+struct OlcHeader {
+    uint32_t id;
+    uint32_t size;
+    uint32_t correlation_id;
+};
+
+struct Options {
+    Protocol protocol = Protocol::olc;
+    std::string host  = "127.0.0.1";
+    std::string port  = "10000";
+    int connections   = 16;
+    int seconds       = 10;
+    int threads       = 1;
+    std::string label = "";
+};
+
+//* 모든 세션이 공유하는 측정 결과. 지연 시간 샘플은 세션이 끝날 때 한번에
+//* 합치므로 요청 경로에서는 잠금이 없다.
+struct Stats {
+    std::mutex guard;
+    std::vector<double> latencies_us;
+    std::atomic<uint64_t> errors{0};
+    // Requests the server answered with "Busy", not part of the latencies
+    std::atomic<uint64_t> busy{0};
+
+    void Merge(std::vector<double>& samples) {
+        std::scoped_lock lock(guard);
+        latencies_us.insert(latencies_us.end(), samples.begin(), samples.end());
+    }
+};
+
+class Session : public std::enable_shared_from_this<Session> {
+ public:
+    Session(asio::io_context& ioc, const Options& opt,
+            const asio::ip::tcp::resolver::results_type& endpoints,
+            Stats& stats, Clock::time_point deadline, int index)
+        : m_opt(opt),
+          m_endpoints(endpoints),
+          m_stats(stats),
+          m_deadline(deadline),
+          m_sock(ioc),
+          m_tag("load-" + std::to_string(index)) {}
+
+    ~Session() { m_stats.Merge(m_samples); }
+
+    void Start() {
+        Connect([self = shared_from_this()]() { self->SendRequest(); });
+    }
+
+ private:
+    template <typename Handler>
+    void Connect(Handler handler) {
+        asio::async_connect(
+            m_sock, m_endpoints,
+            [self = shared_from_this(), handler](
+                const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
+                if (ec) {
+                    self->m_stats.errors++;
+                    return;
+                }
+                self->m_sock.set_option(asio::ip::tcp::no_delay(true));
+                handler();
+            });
+    }
+
+    void SendRequest() {
+        if (Clock::now() >= m_deadline) {
+            asio::error_code ignored;
+            m_sock.close(ignored);
+            return;
+        }
+
+        m_tStart = Clock::now();
+        switch (m_opt.protocol) {
+            case Protocol::olc: {
+                // 헤더 + system_clock::time_point 바디 (서버가 그대로 돌려준다)
+                auto now = std::chrono::system_clock::now();
+                OlcHeader header{OLC_SERVER_PING, sizeof(now), 0};
+                m_out.resize(sizeof(header) + sizeof(now));
+                std::memcpy(m_out.data(), &header, sizeof(header));
+                std::memcpy(m_out.data() + sizeof(header), &now, sizeof(now));
+            } break;
+            case Protocol::line:
+                m_out = "EMULATE_LONG_CALC_OP 1\n";
+                break;
+            case Protocol::chat:
+                m_out = m_tag + "\n";
+                break;
+        }
+
+        asio::async_write(m_sock, asio::buffer(m_out),
+                          [self = shared_from_this()](
+                              const asio::error_code& ec, std::size_t) {
+                              if (ec) {
+                                  self->Fail();
+                                  return;
+                              }
+                              self->ReadResponse();
+                          });
+    }
+
+    void ReadResponse() {
+        if (m_opt.protocol == Protocol::olc) {
+            asio::async_read(
+                m_sock, asio::buffer(&m_inHeader, sizeof(m_inHeader)),
+                [self = shared_from_this()](const asio::error_code& ec,
+                                            std::size_t) {
+                    if (ec) {
+                        self->Fail();
+                        return;
+                    }
+                    self->ReadOlcBody();
+                });
+            return;
+        }
+
+        asio::async_read_until(
+            m_sock, m_buf, '\n',
+            [self = shared_from_this()](const asio::error_code& ec,
+                                        std::size_t n) {
+                if (ec) {
+                    self->Fail();
+                    return;
+                }
+                std::string line(asio::buffers_begin(self->m_buf.data()),
+                                 asio::buffers_begin(self->m_buf.data()) + n);
+                self->m_buf.consume(n);
+
+                // 채팅 서버는 다른 클라이언트의 메세지도 보내주므로 자신의
+                // 태그가 들어간 줄이 올 때까지 계속 읽는다.
+                if (self->m_opt.protocol == Protocol::chat &&
+                    line.find(self->m_tag + "\n") == std::string::npos) {
+                    self->ReadResponse();
+                    return;
+                }
+                self->Complete(self->m_opt.protocol == Protocol::line &&
+                               line == "Busy\n");
+            });
+    }
+
+    // 접속하면 서버가 ServerAccept를 먼저 보내므로 ServerPing 응답이 올 때까지
+    // 헤더에 적힌 크기만큼 바디를 읽고 버린다.
+    void ReadOlcBody() {
+        m_in.resize(m_inHeader.size);
+        asio::async_read(m_sock, asio::buffer(m_in),
+                         [self = shared_from_this()](const asio::error_code& ec,
+                                                     std::size_t) {
+                             if (ec) {
+                                 self->Fail();
+                                 return;
+                             }
+                             if (self->m_inHeader.id != OLC_SERVER_PING) {
+                                 self->ReadResponse();
+                                 return;
+                             }
+                             self->Complete();
+                         });
+    }
+
+    void Complete(bool bBusy = false) {
+        if (!bBusy) {
+            std::chrono::duration<double, std::micro> elapsed =
+                Clock::now() - m_tStart;
+            m_samples.push_back(elapsed.count());
+            SendRequest();
+            return;
+        }
+
+        // 연결 수 제한으로 거절된 연결은 서버가 Busy 후 끊으므로, 어느 쪽이든
+        // 새로 연결한다.
+        m_stats.busy++;
+        asio::error_code ignored;
+        m_sock.close(ignored);
+        m_buf.consume(m_buf.size());
+        if (Clock::now() < m_deadline) {
+            Connect([self = shared_from_this()]() { self->SendRequest(); });
+        }
+    }
+
+    void Fail() {
+        m_stats.errors++;
+        asio::error_code ignored;
+        m_sock.close(ignored);
+    }
+
+    const Options& m_opt;
+    const asio::ip::tcp::resolver::results_type& m_endpoints;
+    Stats& m_stats;
+    Clock::time_point m_deadline;
+
+    asio::ip::tcp::socket m_sock;
+    std::string m_tag;
+    std::string m_out;
+    OlcHeader m_inHeader{};
+    std::string m_in;
+    asio::streambuf m_buf;
+    Clock::time_point m_tStart;
+    std::vector<double> m_samples;
+};
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t idx = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 6) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <olc|line|chat> <host> <port> <connections> <seconds>"
+                     " [threads] [label]\n";
+        return 1;
+    }
+
+    Options opt;
+    if (std::strcmp(argv[1], "line") == 0) {
+        opt.protocol = Protocol::line;
+    } else if (std::strcmp(argv[1], "chat") == 0) {
+        opt.protocol = Protocol::chat;
+    }
+    opt.host        = argv[2];
+    opt.port        = argv[3];
+    opt.connections = std::atoi(argv[4]);
+    opt.seconds     = std::atoi(argv[5]);
+    if (argc > 6) {
+        opt.threads = std::max(1, std::atoi(argv[6]));
+    }
+    if (argc > 7) {
+        opt.label = argv[7];
+    }
+
+    Stats stats;
+    try {
+        asio::io_context ioc;
+        asio::ip::tcp::resolver resolver(ioc);
+        auto endpoints = resolver.resolve(opt.host, opt.port);
+
+        auto tStart   = Clock::now();
+        auto deadline = tStart + std::chrono::seconds(opt.seconds);
+        for (int i = 0; i < opt.connections; i++) {
+            std::make_shared<Session>(ioc, opt, endpoints, stats, deadline, i)
+                ->Start();
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < opt.threads; i++) {
+            threads.emplace_back([&ioc]() { ioc.run(); });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+
+        std::chrono::duration<double> elapsed = Clock::now() - tStart;
+        double throughput = stats.latencies_us.size() / elapsed.count();
+        std::sort(stats.latencies_us.begin(), stats.latencies_us.end());
+        std::cout << (opt.label.empty() ? argv[1] : opt.label)
+                  << "\trequests=" << stats.latencies_us.size()
+                  << "\terrors=" << stats.errors.load()
+                  << "\tbusy=" << stats.busy.load()
+                  << "\tthroughput=" << throughput << " req/s"
+                  << "\tp50=" << Percentile(stats.latencies_us, 50)
+                  << "us\tp99=" << Percentile(stats.latencies_us, 99)
+                  << "us\tp99.9=" << Percentile(stats.latencies_us, 99.9)
+                  << "us\tmax="
+                  << (stats.latencies_us.empty() ? 0.0
+                                                 : stats.latencies_us.back())
+                  << "us\n";
+    } catch (asio::system_error& e) {
+        std::cout << "Error occured! Error code = " << e.code()
+                  << ". Message: " << e.what();
+        return e.code().value();
+    }
+
+    return 0;
+}
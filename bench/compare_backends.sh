@@ -0,0 +1,31 @@
+#!/bin/sh
+# 같은 서버를 epoll/io_uring으로 각각 빌드한 바이너리에 같은 부하를 주고
+# bench_backend_load의 결과 (처리량, p50/p99/p99.9 지연 시간)를 나란히 출력한다.
+#
+# Usage: compare_backends.sh <load> <seconds> <connections>
+#            <protocol> <port> <epoll_server> <uring_server> [...]
+set -e
+
+LOAD=$1
+DURATION=$2
+CONNECTIONS=$3
+shift 3
+
+while [ $# -ge 4 ]; do
+    PROTOCOL=$1
+    PORT=$2
+    EPOLL_SERVER=$3
+    URING_SERVER=$4
+    shift 4
+
+    for SERVER in "$EPOLL_SERVER" "$URING_SERVER"; do
+        "$SERVER" > /dev/null 2>&1 &
+        PID=$!
+        # 서버가 listen을 시작할 때까지 기다린다.
+        sleep 1
+        "$LOAD" "$PROTOCOL" 127.0.0.1 "$PORT" "$CONNECTIONS" "$DURATION" 1 \
+            "$(basename "$SERVER")" || true
+        kill "$PID" 2> /dev/null || true
+        wait "$PID" 2> /dev/null || true
+    done
+done
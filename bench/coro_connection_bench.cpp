@@ -0,0 +1,148 @@
+/**
+ * @file coro_connection_bench.cpp
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 콜백 기반 connection과 코루틴 기반 connection의 처리량 비교
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <asio.hpp>
+
+#include "net_connection.h"
+#include "net_connection_coro.h"
+
+enum class BenchMsgTypes : uint32_t {
+    Payload,
+};
+
+using work_guard_type =
+    asio::executor_work_guard<asio::io_context::executor_type>;
+
+//* tsqueue::wait()을 쓰지 않고 n개의 메세지가 들어올 때까지 양보하며 기다린다.
+template <typename Queue>
+void DrainN(Queue& q, size_t n) {
+    size_t received = 0;
+    while (received < n) {
+        if (q.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        q.pop_front();
+        received++;
+    }
+}
+
+struct BenchResult {
+    double stream_msgs_per_sec;
+    double stream_mb_per_sec;
+    double echo_rtt_us;
+};
+
+//* Connection 타입만 다르고 측정 방식은 같다.
+//* 1. stream: 클라이언트가 n개의 메세지를 연달아 보내고 서버 큐에 모두 들어올
+//*    때까지의 시간
+//* 2. echo: 메세지 하나를 보내고 되돌려 받는 왕복 시간의 평균
+template <typename Connection, typename OwnedMessage>
+BenchResult Run(size_t nStream, size_t nEcho, size_t nPayload) {
+    asio::io_context ioc;
+    work_guard_type work(ioc.get_executor());
+    olc::net::tsqueue<OwnedMessage> qServerIn;
+    olc::net::tsqueue<OwnedMessage> qClientIn;
+
+    // 연결 수립 과정은 측정 대상이 아니므로 미리 연결된 소켓 쌍을 만들고,
+    // 양쪽 모두 ConnectToClient()로 읽기를 시작한다. 콜백 구현은 헤더와 바디를
+    // 따로 쓰기 때문에 Nagle 알고리즘이 켜져 있으면 지연된 ACK를 기다리느라
+    // 왕복 시간이 수십 ms가 된다. 구현 자체를 비교하기 위해 양쪽 모두 끈다.
+    asio::ip::tcp::acceptor acceptor(
+        ioc, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+    asio::ip::tcp::socket client_sock(ioc);
+    client_sock.connect(acceptor.local_endpoint());
+    asio::ip::tcp::socket server_sock = acceptor.accept();
+    client_sock.set_option(asio::ip::tcp::no_delay(true));
+    server_sock.set_option(asio::ip::tcp::no_delay(true));
+
+    auto server = std::make_shared<Connection>(
+        Connection::owner::server, ioc, std::move(server_sock), qServerIn);
+    auto client = std::make_shared<Connection>(
+        Connection::owner::server, ioc, std::move(client_sock), qClientIn);
+    server->ConnectToClient(1);
+    client->ConnectToClient(2);
+
+    std::thread th([&ioc]() { ioc.run(); });
+
+    olc::net::message<BenchMsgTypes> msg;
+    msg.header.id = BenchMsgTypes::Payload;
+    msg.body.resize(nPayload);
+    msg.header.size = msg.size();
+
+    BenchResult result{};
+
+    // stream
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nStream; i++) {
+            client->Send(msg);
+        }
+        DrainN(qServerIn, nStream);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - tStart;
+        result.stream_msgs_per_sec = nStream / elapsed.count();
+        double nBytes =
+            nStream *
+            double(nPayload + sizeof(olc::net::message_header<BenchMsgTypes>));
+        result.stream_mb_per_sec = nBytes / elapsed.count() / (1024.0 * 1024.0);
+    }
+
+    // echo: 서버 측 connection이 받은 메세지를 그대로 돌려보낸다.
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nEcho; i++) {
+            client->Send(msg);
+            DrainN(qServerIn, 1);
+            server->Send(msg);
+            DrainN(qClientIn, 1);
+        }
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - tStart;
+        result.echo_rtt_us = elapsed.count() / nEcho;
+    }
+
+    server->Disconnect();
+    client->Disconnect();
+    work.reset();
+    ioc.stop();
+    th.join();
+    return result;
+}
+
+void Print(const char* name, const BenchResult& r) {
+    std::cout << name << "\tstream: " << r.stream_msgs_per_sec << " msg/s, "
+              << r.stream_mb_per_sec << " MB/s\techo: " << r.echo_rtt_us
+              << " us\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t nStream  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t nPayload = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+    size_t nEcho    = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20000;
+
+    std::cout << "messages: " << nStream << ", payload: " << nPayload
+              << " bytes, echo round trips: " << nEcho << "\n";
+
+    Print("callback", Run<olc::net::connection<BenchMsgTypes>,
+                          olc::net::owned_message<BenchMsgTypes>>(
+                          nStream, nEcho, nPayload));
+    Print("coroutine",
+          Run<olc::net::coro::connection<BenchMsgTypes>,
+              olc::net::coro::connection<BenchMsgTypes>::owned_message_type>(
+              nStream, nEcho, nPayload));
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file micro_harness.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 마이크로 벤치마크용 작은 in-tree harness
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bench {
+
+// Keep the compiler from optimising a value or the memory writes away
+#if defined(_MSC_VER)
+namespace detail {
+// MSVC has no inline asm on x64. Publishing the address to a volatile sink
+// keeps the value in memory, the barrier keeps the writes to it.
+inline const volatile char* volatile g_sink = nullptr;
+}  // namespace detail
+
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    detail::g_sink = &reinterpret_cast<const volatile char&>(value);
+    _ReadWriteBarrier();
+}
+
+inline void ClobberMemory() { _ReadWriteBarrier(); }
+#else
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+#endif
+
+//* 각 벤치마크는 반복 횟수를 인자로 받아 그만큼 연산을 수행하는 함수다.
+//* 1. 한번 실행해서 캐시/할당자/스레드를 데운다 (warm up).
+//* 2. 한번 실행에 min_time 이상 걸리도록 반복 횟수를 두배씩 늘린다.
+//* 3. 같은 반복 횟수로 repetitions번 실행하고 op당 시간의 중앙값을 보고한다.
+//* 중앙값과 변동 계수 (cv)를 함께 출력하므로 커밋 간 비교 시 잡음을 가늠할 수
+//* 있다. --out으로 결과를 TSV로 저장하고 --baseline으로 이전 결과와 비교한다.
+class harness {
+ public:
+    using function_type = std::function<void(size_t iterations)>;
+
+    void add(std::string name, function_type fn) {
+        m_vecBenchmarks.push_back({std::move(name), std::move(fn)});
+    }
+
+    int run(int argc, char* argv[]) {
+        if (!ParseArgs(argc, argv)) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--filter substring] [--repetitions n]"
+                         " [--min-time seconds] [--out results.tsv]"
+                         " [--baseline results.tsv]\n";
+            return 1;
+        }
+        std::map<std::string, double> baseline = LoadBaseline();
+
+        std::cout << std::left << std::setw(40) << "benchmark" << std::right
+                  << std::setw(14) << "median ns/op" << std::setw(14)
+                  << "min ns/op" << std::setw(8) << "cv%" << std::setw(14)
+                  << "iterations"
+                  << (baseline.empty() ? "" : "   vs baseline") << "\n";
+
+        std::ofstream out;
+        if (!m_sOut.empty()) {
+            out.open(m_sOut);
+            out << "name\tmedian_ns\tmin_ns\tcv_pct\titerations\n";
+        }
+
+        for (auto& b : m_vecBenchmarks) {
+            if (!m_sFilter.empty() &&
+                b.name.find(m_sFilter) == std::string::npos) {
+                continue;
+            }
+            result r = Measure(b.fn);
+
+            std::cout << std::left << std::setw(40) << b.name << std::right
+                      << std::fixed << std::setprecision(2) << std::setw(14)
+                      << r.median_ns << std::setw(14) << r.min_ns
+                      << std::setprecision(1) << std::setw(8) << r.cv_pct
+                      << std::setw(14) << r.iterations;
+            if (auto it = baseline.find(b.name); it != baseline.end()) {
+                double delta = (r.median_ns / it->second - 1.0) * 100.0;
+                std::cout << "   " << std::showpos << delta << "%"
+                          << std::noshowpos;
+            }
+            std::cout << "\n";
+
+            if (out) {
+                out << b.name << "\t" << r.median_ns << "\t" << r.min_ns
+                    << "\t" << r.cv_pct << "\t" << r.iterations << "\n";
+            }
+        }
+        return 0;
+    }
+
+ private:
+    struct benchmark {
+        std::string name;
+        function_type fn;
+    };
+
+    struct result {
+        double median_ns;
+        double min_ns;
+        double cv_pct;
+        size_t iterations;
+    };
+
+    static double TimeRun(const function_type& fn, size_t iterations) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn(iterations);
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(t1 - t0).count();
+    }
+
+    result Measure(const function_type& fn) const {
+        TimeRun(fn, 1);
+
+        size_t iterations = 1;
+        while (TimeRun(fn, iterations) < m_dMinTime && iterations < (1u << 30)) {
+            iterations *= 2;
+        }
+
+        std::vector<double> samples;
+        for (int i = 0; i < m_nRepetitions; i++) {
+            samples.push_back(TimeRun(fn, iterations) * 1e9 / iterations);
+        }
+        std::sort(samples.begin(), samples.end());
+
+        double mean = 0.0;
+        for (double s : samples) {
+            mean += s;
+        }
+        mean /= samples.size();
+        double var = 0.0;
+        for (double s : samples) {
+            var += (s - mean) * (s - mean);
+        }
+        var /= samples.size();
+
+        return {samples[samples.size() / 2], samples.front(),
+                mean > 0.0 ? std::sqrt(var) / mean * 100.0 : 0.0, iterations};
+    }
+
+    bool ParseArgs(int argc, char* argv[]) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string key = argv[i];
+            const char* val = argv[i + 1];
+            if (key == "--filter") {
+                m_sFilter = val;
+            } else if (key == "--repetitions") {
+                m_nRepetitions = std::max(1, std::atoi(val));
+            } else if (key == "--min-time") {
+                m_dMinTime = std::atof(val);
+            } else if (key == "--out") {
+                m_sOut = val;
+            } else if (key == "--baseline") {
+                m_sBaseline = val;
+            } else {
+                return false;
+            }
+        }
+        return argc % 2 == 1;
+    }
+
+    std::map<std::string, double> LoadBaseline() const {
+        std::map<std::string, double> baseline;
+        std::ifstream in(m_sBaseline);
+        std::string line;
+        std::getline(in, line);  // header
+        while (std::getline(in, line)) {
+            size_t tab = line.find('\t');
+            if (tab != std::string::npos) {
+                baseline[line.substr(0, tab)] =
+                    std::atof(line.c_str() + tab + 1);
+            }
+        }
+        return baseline;
+    }
+
+    std::vector<benchmark> m_vecBenchmarks;
+    std::string m_sFilter;
+    std::string m_sOut;
+    std::string m_sBaseline;
+    int m_nRepetitions = 5;
+    double m_dMinTime  = 0.2;
+};
+
+}  // namespace bench
@@ -0,0 +1,336 @@
+/**
+ * @file olc_micro_bench.cpp
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief message<T>, tsqueue, connection<T> 내부 동작의 마이크로 벤치마크
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include <asio.hpp>
+
+#include "micro_harness.h"
+#include "net_connection.h"
+#include "net_message.h"
+#include "net_shm_transport.h"
+#include "net_tsqueue.h"
+
+enum class BenchMsgTypes : uint32_t {
+    Payload,
+};
+
+using Message = olc::net::message<BenchMsgTypes>;
+
+struct Payload64 {
+    uint8_t bytes[64];
+};
+
+//* message<T>의 << / >> 연산자. 같은 메세지를 재사용하므로 body의 capacity는
+//* 첫 반복 이후 그대로이고, resize + memcpy 비용만 측정된다.
+void MessagePushPopU32(size_t n) {
+    Message msg;
+    uint32_t value = 0;
+    for (size_t i = 0; i < n; i++) {
+        msg << uint32_t(i);
+        msg >> value;
+        bench::DoNotOptimize(value);
+    }
+}
+
+void MessagePushPop64B(size_t n) {
+    Message msg;
+    Payload64 payload{};
+    for (size_t i = 0; i < n; i++) {
+        payload.bytes[0] = uint8_t(i);
+        msg << payload;
+        msg >> payload;
+        bench::DoNotOptimize(payload);
+    }
+}
+
+// One op = one element of a 256 element message, built from empty each time
+void MessageBuildDrain256(size_t n) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < n; i += 256) {
+        Message msg;
+        for (uint32_t k = 0; k < 256; k++) {
+            msg << k;
+        }
+        for (uint32_t k = 0; k < 256; k++) {
+            msg >> value;
+        }
+        bench::DoNotOptimize(value);
+    }
+}
+
+void TsqueueSingleThread(size_t n) {
+    olc::net::tsqueue<Message> q;
+    Message msg;
+    for (size_t i = 0; i < n; i++) {
+        q.push_back(msg);
+        bench::DoNotOptimize(q.pop_front());
+    }
+}
+
+//* 생산자 nProducers개가 동시에 push하고 소비자 하나가 pop한다. 서버의 수신
+//* 큐와 같은 모양 (여러 asio 스레드 -> Update 스레드)이다. 소비자는 wait()을
+//* 쓰지 않고 양보하며 기다린다. op는 메세지 하나다.
+void TsqueueContended(size_t n, size_t nProducers) {
+    olc::net::tsqueue<Message> q;
+    size_t nPerProducer = std::max<size_t>(1, n / nProducers);
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < nProducers; p++) {
+        producers.emplace_back([&q, &go, nPerProducer]() {
+            Message msg;
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            for (size_t i = 0; i < nPerProducer; i++) {
+                q.push_back(msg);
+            }
+        });
+    }
+
+    go.store(true, std::memory_order_release);
+    size_t received = 0;
+    while (received < nPerProducer * nProducers) {
+        if (q.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        q.pop_front();
+        received++;
+    }
+    for (auto& th : producers) {
+        th.join();
+    }
+}
+
+//* 미리 연결된 connection 한 쌍. server는 받은 메세지를 그대로 돌려보내고,
+//* client는 응답을 받을 때마다 카운터를 올린다. 두 쪽 모두 수신 필터에서
+//* 처리하므로 큐를 거치지 않고 connection 자체의 비용만 잰다.
+//* TCP는 loopback으로, Unix domain socket은 socketpair로 연결한다.
+template <typename Protocol>
+class LoopbackPair {
+ public:
+    using Connection = olc::net::connection<BenchMsgTypes, Protocol>;
+    using OwnedQueue =
+        olc::net::tsqueue<typename Connection::owned_message_type>;
+
+    LoopbackPair() : m_work(m_ioc.get_executor()) {
+        typename Protocol::socket clientSock(m_ioc);
+        typename Protocol::socket serverSock(m_ioc);
+        if constexpr (std::is_same_v<Protocol, asio::ip::tcp>) {
+            asio::ip::tcp::acceptor acceptor(
+                m_ioc,
+                asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+            clientSock.connect(acceptor.local_endpoint());
+            serverSock = acceptor.accept();
+        } else {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+            asio::local::connect_pair(clientSock, serverSock);
+#endif
+        }
+
+        // Both ends are accepted style connections, nobody has to connect
+        m_server = std::make_shared<Connection>(Connection::owner::server,
+                                                m_ioc, std::move(serverSock),
+                                                m_qUnused);
+        m_client = std::make_shared<Connection>(Connection::owner::server,
+                                                m_ioc, std::move(clientSock),
+                                                m_qUnused);
+        m_server->SetSocketOptions(olc::net::socket_options());
+        m_client->SetSocketOptions(olc::net::socket_options());
+
+        m_server->SetIncomingFilter([this](Message& msg) {
+            m_server->Send(msg);
+            return true;
+        });
+        m_client->SetIncomingFilter([this](Message&) {
+            m_nReplies.fetch_add(1, std::memory_order_release);
+            return true;
+        });
+        m_server->ConnectToClient(1);
+        m_client->ConnectToClient(2);
+
+        m_thread = std::thread([this]() { m_ioc.run(); });
+    }
+
+    ~LoopbackPair() {
+        m_ioc.stop();
+        m_thread.join();
+    }
+
+    // One op = one request/response round trip
+    void RoundTrip(size_t n, size_t nPayload) {
+        Message msg;
+        msg.body.resize(nPayload);
+        msg.header.size = msg.size();
+        for (size_t i = 0; i < n; i++) {
+            size_t nBefore = m_nReplies.load(std::memory_order_acquire);
+            m_client->Send(msg);
+            while (m_nReplies.load(std::memory_order_acquire) == nBefore) {
+            }
+        }
+    }
+
+    // One op = one message of a pipelined stream, replies are awaited at the
+    // end only
+    void Pipelined(size_t n, size_t nPayload) {
+        Message msg;
+        msg.body.resize(nPayload);
+        msg.header.size = msg.size();
+        size_t nTarget  = m_nReplies.load(std::memory_order_acquire) + n;
+        for (size_t i = 0; i < n; i++) {
+            m_client->Send(msg);
+        }
+        while (m_nReplies.load(std::memory_order_acquire) < nTarget) {
+            std::this_thread::yield();
+        }
+    }
+
+ private:
+    asio::io_context m_ioc;
+    asio::executor_work_guard<asio::io_context::executor_type> m_work;
+    OwnedQueue m_qUnused;
+    std::shared_ptr<Connection> m_server;
+    std::shared_ptr<Connection> m_client;
+    std::atomic<size_t> m_nReplies{0};
+    std::thread m_thread;
+};
+
+#if defined(__linux__)
+//* LoopbackPair와 같은 모양이지만 공유 메모리 링 위의 shm_connection 한 쌍이다.
+//* 세그먼트 하나의 양 끝을 한 프로세스에서 잡고, 각자 수신 스레드를 돌린다.
+class ShmPair {
+ public:
+    using Connection = olc::net::shm_connection<BenchMsgTypes>;
+    using OwnedQueue =
+        olc::net::tsqueue<typename Connection::owned_message_type>;
+
+    explicit ShmPair(const olc::net::shm_options& options) {
+        m_segment.create("olc_micro_bench." + std::to_string(getpid()),
+                         options.ring_bytes);
+        m_segment.ctl()->state.store(olc::net::shm_segment::attached);
+
+        m_server = std::make_shared<Connection>(Connection::owner::server,
+                                                m_segment, options, m_qUnused);
+        m_client = std::make_shared<Connection>(Connection::owner::client,
+                                                m_segment, options, m_qUnused);
+        m_server->SetIncomingFilter([this](Message& msg) {
+            m_server->Send(msg);
+            return true;
+        });
+        m_client->SetIncomingFilter([this](Message&) {
+            m_nReplies.fetch_add(1, std::memory_order_release);
+            return true;
+        });
+
+        m_serverThread = std::thread([this]() { m_server->ReadLoop(1); });
+        m_clientThread = std::thread([this]() { m_client->ReadLoop(2); });
+    }
+
+    ~ShmPair() {
+        m_client->Disconnect();
+        m_serverThread.join();
+        m_clientThread.join();
+    }
+
+    void RoundTrip(size_t n, size_t nPayload) {
+        Message msg;
+        msg.body.resize(nPayload);
+        for (size_t i = 0; i < n; i++) {
+            size_t nBefore = m_nReplies.load(std::memory_order_acquire);
+            m_client->Send(msg);
+            while (m_nReplies.load(std::memory_order_acquire) == nBefore) {
+            }
+        }
+    }
+
+    void Pipelined(size_t n, size_t nPayload) {
+        Message msg;
+        msg.body.resize(nPayload);
+        size_t nTarget = m_nReplies.load(std::memory_order_acquire) + n;
+        for (size_t i = 0; i < n; i++) {
+            m_client->Send(msg);
+        }
+        while (m_nReplies.load(std::memory_order_acquire) < nTarget) {
+            std::this_thread::yield();
+        }
+    }
+
+ private:
+    olc::net::shm_segment m_segment;
+    OwnedQueue m_qUnused;
+    std::shared_ptr<Connection> m_server;
+    std::shared_ptr<Connection> m_client;
+    std::atomic<size_t> m_nReplies{0};
+    std::thread m_serverThread;
+    std::thread m_clientThread;
+};
+#endif
+
+int main(int argc, char* argv[]) {
+    bench::harness h;
+
+    h.add("message/push_pop_u32", MessagePushPopU32);
+    h.add("message/push_pop_64B", MessagePushPop64B);
+    h.add("message/build_drain_256xu32", MessageBuildDrain256);
+
+    h.add("tsqueue/push_pop_1thread", TsqueueSingleThread);
+    for (size_t p : {1, 2, 4}) {
+        h.add("tsqueue/mpsc_" + std::to_string(p) + "producers",
+              [p](size_t n) { TsqueueContended(n, p); });
+    }
+
+    // TCP loopback against Unix domain socket, same connection<T> code
+    LoopbackPair<asio::ip::tcp> tcpPair;
+    for (size_t size : {0, 64, 4096}) {
+        h.add("connection/roundtrip_" + std::to_string(size) + "B",
+              [&tcpPair, size](size_t n) { tcpPair.RoundTrip(n, size); });
+        h.add("connection/pipelined_" + std::to_string(size) + "B",
+              [&tcpPair, size](size_t n) { tcpPair.Pipelined(n, size); });
+    }
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    LoopbackPair<asio::local::stream_protocol> udsPair;
+    for (size_t size : {0, 64, 4096}) {
+        h.add("connection_uds/roundtrip_" + std::to_string(size) + "B",
+              [&udsPair, size](size_t n) { udsPair.RoundTrip(n, size); });
+        h.add("connection_uds/pipelined_" + std::to_string(size) + "B",
+              [&udsPair, size](size_t n) { udsPair.Pipelined(n, size); });
+    }
+#endif
+#if defined(__linux__)
+    // Futex wakeups, and busy polling readers where there are enough cores
+    // for both readers and the sending thread to spin
+    ShmPair shmPair{olc::net::shm_options()};
+    std::unique_ptr<ShmPair> shmPollPair;
+    if (std::thread::hardware_concurrency() >= 4) {
+        olc::net::shm_options options;
+        options.busy_poll = true;
+        shmPollPair       = std::make_unique<ShmPair>(options);
+    }
+    for (size_t size : {0, 64, 4096}) {
+        h.add("connection_shm/roundtrip_" + std::to_string(size) + "B",
+              [&shmPair, size](size_t n) { shmPair.RoundTrip(n, size); });
+        h.add("connection_shm/pipelined_" + std::to_string(size) + "B",
+              [&shmPair, size](size_t n) { shmPair.Pipelined(n, size); });
+        if (shmPollPair) {
+            h.add("connection_shm_poll/roundtrip_" + std::to_string(size) +
+                      "B",
+                  [&shmPollPair, size](size_t n) {
+                      shmPollPair->RoundTrip(n, size);
+                  });
+        }
+    }
+#endif
+
+    return h.run(argc, argv);
+}
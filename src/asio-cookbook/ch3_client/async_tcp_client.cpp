@@ -24,8 +24,8 @@
 #include "asio/executor_work_guard.hpp"
 #include "asio/io_context.hpp"
 #include "asio/ip/address.hpp"
-#include "asio/streambuf.hpp"
 #include "asio/system_error.hpp"
+#include "line_reader.h"
 
 // using Func     = int();                      // function typedef
 // using Funcp_t  = int(*)();                   // function pointer typedef
@@ -56,9 +56,9 @@ struct Session {
     asio::ip::tcp::endpoint m_ep;  // Remote endpoint.
     std::string m_request;         // Request string
 
-    // streambuf where the response will be stored.
-    //* 응답 길이를 모르므로 우선 streambuf로 받는다.
-    asio::streambuf m_response_buf;
+    // Buffer where the response will be received.
+    //* 응답 길이를 모르므로 줄 단위 수신 버퍼로 받는다.
+    lineio::line_reader<asio::ip::tcp::socket> m_response_buf{m_sock};
     std::string m_response;  // Response represented as a string.
     // Contains the description of an error if one occurs during
     // the request lifecycle.
@@ -162,15 +162,13 @@ class AsyncTCPClient : public asio::noncopyable {
                             return;
                         }
 
-                        asio::async_read_until(
-                            session->m_sock, session->m_response_buf, '\n',
+                        session->m_response_buf.async_read_line(
                             [this, session](const asio::error_code& ec,
-                                            std::size_t bytes_transferred) {
+                                            std::string_view response) {
                                 if (ec.value() != 0) {
                                     session->m_ec = ec;
                                 } else {
-                                    std::istream strm(&session->m_response_buf);
-                                    std::getline(strm, session->m_response);
+                                    session->m_response = response;
                                 }
 
                                 OnRequestComplete(session);
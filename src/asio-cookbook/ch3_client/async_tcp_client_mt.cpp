@@ -10,7 +10,6 @@
  */
 
 #include <iostream>
-#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -25,8 +24,9 @@
 #include "asio/executor_work_guard.hpp"
 #include "asio/io_context.hpp"
 #include "asio/ip/address.hpp"
-#include "asio/streambuf.hpp"
 #include "asio/system_error.hpp"
+#include "io_threads.h"
+#include "line_reader.h"
 
 using Callback = void (*)(unsigned int request_id, const std::string& response,
                           const asio::error_code& ec);
@@ -53,7 +53,7 @@ struct Session {
     asio::ip::tcp::endpoint m_ep;
     std::string m_request;
 
-    asio::streambuf m_response_buf;
+    lineio::line_reader<asio::ip::tcp::socket> m_response_buf{m_sock};
     std::string m_response;
     asio::error_code m_ec;
 
@@ -70,18 +70,15 @@ class AsyncTCPClientMT : public asio::noncopyable {
     /**
      * @brief work_guard와 스레드를 시작한다.
      * work_guard는 남은 비동기 연산이 없더라도 io_context가 이벤트 루프를 끝내지 않도록 막는다.
+     * 스레드는 io_placement의 CPU에 고정되고 이름이 붙는다.
      */
-    explicit AsyncTCPClientMT(unsigned char num_of_threads) {
+    explicit AsyncTCPClientMT(unsigned char num_of_threads,
+                              const iothreads::placement& io_placement =
+                                  iothreads::placement::from_env("IO_CPUS",
+                                                                 "cli-io"))
+        : m_threads(io_placement) {
         m_work = std::make_unique<work_guard_type>(m_ioc.get_executor());
-        for (auto i = 1; i <= num_of_threads; i++) {
-            m_threads.push_back(
-                std::make_unique<std::thread>([this]() { m_ioc.run(); }));
-
-            //? 아래와 차이가 있나?
-            // std::unique_ptr<std::thread> th(
-            //     new std::thread([this]() { m_ioc.run(); }));
-            // m_threads.push_back(std::move(th));
-        }
+        m_threads.run(m_ioc, num_of_threads);
     }
 
     /**
@@ -161,15 +158,13 @@ class AsyncTCPClientMT : public asio::noncopyable {
                             return;
                         }
 
-                        asio::async_read_until(
-                            session->m_sock, session->m_response_buf, '\n',
+                        session->m_response_buf.async_read_line(
                             [this, session](const asio::error_code& ec,
-                                            std::size_t bytes_transferred) {
+                                            std::string_view response) {
                                 if (ec.value() != 0) {
                                     session->m_ec = ec;
                                 } else {
-                                    std::istream strm(&session->m_response_buf);
-                                    std::getline(strm, session->m_response);
+                                    session->m_response = response;
                                 }
 
                                 OnRequestComplete(session);
@@ -215,9 +210,7 @@ class AsyncTCPClientMT : public asio::noncopyable {
         m_work.reset(nullptr);
 
         // Wait for the I/O thread to exit.
-        for (auto& thread : m_threads) {
-            thread->join();
-        }
+        m_threads.join();
     }
 
  private:
@@ -279,7 +272,7 @@ class AsyncTCPClientMT : public asio::noncopyable {
      * 동일한 io_context로 제어할 경우, 풀에 있는 모든 스레드가 비동기 연산 완료 후 콜백을 호출할 때 사용된다.
      * 단일 스레드는 비동기 연산이 하나 씩 실행된다면 스레드 풀을 사용할 경우 스레드 수만큼의 비동기 연산이 동시에 실행된다.
      */
-    std::list<std::unique_ptr<std::thread>> m_threads;
+    iothreads::io_thread_pool m_threads;
 };
 
 /**
@@ -9,123 +9,790 @@
  * 
  */
 #include <atomic>
-#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string_view>
 #include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include <asio.hpp>
 
 #include "asio/error_code.hpp"
 #include "asio/io_context.hpp"
-#include "asio/read_until.hpp"
-#include "asio/streambuf.hpp"
+#include "asio/steady_timer.hpp"
+#include "asio/strand.hpp"
+#include "asio/thread_pool.hpp"
+#include "async_log.h"
+#include "io_threads.h"
+#include "line_reader.h"
+#include "trace.h"
 
 using work_guard_type =
     asio::executor_work_guard<asio::io_context::executor_type>;
 
+//* 요청 처리는 io 스레드가 아닌 별도의 스레드 풀에서 한다. 계산은 코어 수
+//* 만큼의 cpu 풀에서, 스레드를 재우는 작업 (동기 I/O 등)은 그보다 큰 blocking
+//* 풀에서 하고 결과는 연결의 strand로 돌려 보낸다. io 스레드는 잠들지 않으므로
+//* 코어 수만큼이면 충분하고, 처리가 밀려도 accept은 멈추지 않는다.
+struct WorkerPools {
+    WorkerPools(size_t cpu_threads, size_t blocking_threads)
+        : cpu(cpu_threads), blocking(blocking_threads) {}
+
+    // Queued work is dropped, running work is waited for
+    void Stop() {
+        cpu.stop();
+        blocking.stop();
+        cpu.join();
+        blocking.join();
+    }
+
+    asio::thread_pool cpu;
+    asio::thread_pool blocking;
+};
+
+class Service;
+
+//* pool에서 꺼낸 (Acquire) 뒤 돌려 놓기 (Release) 전까지의 서비스 객체들.
+//* Server::Stop이 이들에게 종료를 알리고 모두 돌아올 때까지 기다린다.
+class ServiceTracker {
+ public:
+    void Add(Service* service) {
+        std::scoped_lock lock(m_mux);
+        m_setServices.insert(service);
+    }
+
+    void Remove(Service* service) {
+        {
+            std::scoped_lock lock(m_mux);
+            m_setServices.erase(service);
+        }
+        m_cvEmpty.notify_all();
+    }
+
+    bool Contains(Service* service) {
+        std::scoped_lock lock(m_mux);
+        return m_setServices.count(service) > 0;
+    }
+
+    size_t Count() {
+        std::scoped_lock lock(m_mux);
+        return m_setServices.size();
+    }
+
+    // fn runs under the lock, so the services stay alive (and tracked) for it
+    template <typename Fn>
+    void ForEach(Fn fn) {
+        std::scoped_lock lock(m_mux);
+        for (Service* service : m_setServices) {
+            fn(service);
+        }
+    }
+
+    // Stop them being tracked and hand them over, for when nothing can run
+    // their handlers any more
+    std::vector<Service*> TakeAll() {
+        std::scoped_lock lock(m_mux);
+        std::vector<Service*> vecServices(m_setServices.begin(),
+                                          m_setServices.end());
+        m_setServices.clear();
+        return vecServices;
+    }
+
+    // False if some are still out at the deadline
+    bool WaitEmpty(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock lock(m_mux);
+        return m_cvEmpty.wait_until(lock, deadline,
+                                    [this]() { return m_setServices.empty(); });
+    }
+
+ private:
+    std::mutex m_mux;
+    std::condition_variable m_cvEmpty;
+    std::unordered_set<Service*> m_setServices;
+};
+
+// Connection limit and load shedding, see AdmissionControl
+struct AdmissionPolicy {
+    // Connections served at once. Beyond it the acceptor either stops
+    // accepting (new clients wait in the listen backlog) or, with
+    // reject_when_full, accepts them and answers BUSY_RESPONSE right away.
+    size_t max_services   = 1000;
+    bool reject_when_full = false;
+    // Shed requests while their queueing delay has stayed above target for
+    // an interval. A target of zero turns shedding off.
+    std::chrono::milliseconds target{20};
+    std::chrono::milliseconds interval{100};
+};
+
+//* CoDel (Controlled Delay). 요청이 큐에서 기다린 시간 (sojourn)이 interval
+//* 동안 계속 target을 넘으면 요청을 하나 버리고, 그 상태가 이어지는 동안
+//* interval / sqrt(버린 수) 간격으로 점점 자주 버린다. 지연이 target 아래로
+//* 내려오면 멈춘다. 잠깐의 burst는 그대로 받고, 큐가 빠지지 않고 서 있을 때만
+//* 버리므로 과부하에서도 받아 들인 요청의 지연은 target 근처에 머문다.
+class CoDel {
+ public:
+    using clock = std::chrono::steady_clock;
+
+    CoDel(clock::duration target, clock::duration interval)
+        : m_target(target), m_interval(interval) {}
+
+    // Called as each request leaves the queue
+    bool ShouldDrop(clock::duration sojourn, clock::time_point now) {
+        std::scoped_lock lock(m_mux);
+
+        bool bOkToDrop = false;
+        if (sojourn < m_target) {
+            m_tpFirstAbove = clock::time_point();
+        } else if (m_tpFirstAbove == clock::time_point()) {
+            m_tpFirstAbove = now + m_interval;
+        } else if (now >= m_tpFirstAbove) {
+            bOkToDrop = true;
+        }
+
+        if (m_bDropping) {
+            if (!bOkToDrop) {
+                m_bDropping = false;
+                return false;
+            }
+            if (now < m_tpDropNext) {
+                return false;
+            }
+            m_nCount++;
+            m_tpDropNext = ControlLaw(m_tpDropNext);
+            return true;
+        }
+        if (!bOkToDrop) {
+            return false;
+        }
+
+        // Start dropping again. If the last episode ended only recently,
+        // carry on close to the rate it had reached.
+        m_bDropping = true;
+        if (m_nCount > 2 && now - m_tpDropNext < 8 * m_interval) {
+            m_nCount = m_nCount - 2;
+        } else {
+            m_nCount = 1;
+        }
+        m_tpDropNext = ControlLaw(now);
+        return true;
+    }
+
+ private:
+    clock::time_point ControlLaw(clock::time_point t) const {
+        return t + std::chrono::duration_cast<clock::duration>(
+                       m_interval / std::sqrt(static_cast<double>(m_nCount)));
+    }
+
+    const clock::duration m_target;
+    const clock::duration m_interval;
+
+    std::mutex m_mux;
+    clock::time_point m_tpFirstAbove;
+    clock::time_point m_tpDropNext;
+    uint32_t m_nCount = 0;
+    bool m_bDropping  = false;
+};
+
+//* 동시에 서비스하는 연결 수를 세고 (Acceptor가 TryAdmit, Service가 Release될
+//* 때 Leave), 요청의 대기 시간을 CoDel에 넘긴다. reject_when_full이 아니면
+//* 가득 찼을 때 Acceptor가 Pause하고, 연결 하나가 끝나면 resume 콜백으로
+//* 다시 accept을 시작한다. 연결을 받지 않는 동안 새 클라이언트는 커널의
+//* listen backlog에서 기다린다.
+class AdmissionControl {
+ public:
+    explicit AdmissionControl(const AdmissionPolicy& policy)
+        : m_policy(policy), m_codel(policy.target, policy.interval) {}
+
+    const AdmissionPolicy& Policy() const { return m_policy; }
+
+    // ACCEPTOR - counts the connection in if there is room
+    bool TryAdmit() {
+        size_t n = m_nActive.load();
+        while (n < m_policy.max_services) {
+            if (m_nActive.compare_exchange_weak(n, n + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Full() const { return m_nActive.load() >= m_policy.max_services; }
+
+    // An admitted connection has ended
+    void Leave() {
+        m_nActive.fetch_sub(1);
+        if (m_bPaused.exchange(false)) {
+            m_resume();
+        }
+    }
+
+    // ACCEPTOR - wait for a Leave before accepting again. False if one came
+    // in the meantime, then the caller just goes on accepting.
+    bool Pause() {
+        m_bPaused.store(true);
+        if (!Full() && m_bPaused.exchange(false)) {
+            return false;
+        }
+        m_nPauses.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Called (on the thread of the Leave) to end a Pause. Set it before
+    // anything is admitted.
+    void SetResume(std::function<void()> resume) {
+        m_resume = std::move(resume);
+    }
+
+    // BLOCKING POOL - whether to answer the requests that waited this long
+    // with BUSY_RESPONSE instead of doing them
+    bool ShouldShed(std::chrono::steady_clock::duration queue_wait) {
+        if (m_policy.target.count() == 0) {
+            return false;
+        }
+        return m_codel.ShouldDrop(queue_wait,
+                                  std::chrono::steady_clock::now());
+    }
+
+    void CountRejected() {
+        m_nRejected.fetch_add(1, std::memory_order_relaxed);
+    }
+    void CountShed(size_t n) {
+        m_nShed.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Rejected() const { return m_nRejected.load(); }
+    uint64_t Shed() const { return m_nShed.load(); }
+    uint64_t Pauses() const { return m_nPauses.load(); }
+
+ private:
+    const AdmissionPolicy m_policy;
+    CoDel m_codel;
+    std::atomic<size_t> m_nActive{0};
+    std::atomic<bool> m_bPaused{false};
+    std::function<void()> m_resume;
+
+    std::atomic<uint64_t> m_nRejected{0};
+    std::atomic<uint64_t> m_nShed{0};
+    std::atomic<uint64_t> m_nPauses{0};
+};
+
+//* 연결마다 new/delete 하지 않도록 끝난 Service 객체를 스레드 별 free list에
+//* 모아 두고 다음 연결에 다시 쓴다. 소켓 객체와 요청/응답 버퍼도 같이 재사용
+//* 되므로 버퍼가 한번 늘어난 크기는 그대로 남는다. 어느 스레드에서 끝나든 그
+//* 스레드의 list로 가고, 한 스레드에 MAX_POOLED개가 넘으면 그냥 지운다.
+//*
+//* 한 연결에서 요청을 계속 받는다 (keep-alive). 한번 읽은 데이터에 요청이
+//* 여러개 있으면 (pipelining) 모두 순서대로 처리하고 응답을 이어 붙여서 한번에
+//* 보낸다. 다음 요청을 IDLE_TIMEOUT 동안 기다려도 오지 않거나, 클라이언트가
+//* 연결을 끊으면 끝난다. 핸들러는 모두 연결의 strand에서 실행되므로 여러
+//* 스레드가 io_context를 돌려도 한 연결의 핸들러가 동시에 실행되지 않는다.
+//*
+//* 서버가 멈출 때는 Drain으로 다음 요청을 받지 않게 하고 (요청을 기다리던
+//* 중이면 바로 끝난다), 그래도 시간 안에 끝나지 않으면 Abort로 진행 중인
+//* 쓰기를 취소한다.
+//*
+//* 연결 수 제한에 걸린 연결은 StartRejecting으로 BUSY_RESPONSE만 보내고
+//* 끝내고, CoDel이 버리라고 한 요청에는 처리 대신 BUSY_RESPONSE로 답한다.
 class Service {
  public:
-    explicit Service(std::shared_ptr<asio::ip::tcp::socket> sock)
-        : m_sock(sock) {}
+    static constexpr size_t MAX_POOLED = 1024;
+    static constexpr auto IDLE_TIMEOUT = std::chrono::seconds(10);
+    // A request line longer than this ends the connection
+    static constexpr size_t MAX_REQUEST_BYTES = 64 << 10;
+    // The answer to a refused connection or a shed request
+    static constexpr std::string_view BUSY_RESPONSE = "Busy\n";
+    // How long a refused client gets to close its side after BUSY_RESPONSE
+    static constexpr auto LINGER_TIMEOUT = std::chrono::seconds(1);
+
+    explicit Service(asio::io_context& ioc)
+        : m_sock(ioc),
+          m_strand(asio::make_strand(ioc)),
+          m_timer(m_strand),
+          m_reader(m_sock, MAX_REQUEST_BYTES) {}
 
     /**
-     * @brief 클라이언트에서 들어오는 비동기 요청을 읽고 OnRequestReceived를 호출하여 요청을 처리한다.
+     * @brief 이 스레드의 free list에서 Service를 꺼낸다. 비어 있으면 새로 만든다.
+     *
+     * @param ioc 소켓이 쓸 io_context
+     * @param workers 요청을 처리할 스레드 풀
+     * @param tracker Release될 때까지 서비스 객체를 등록해 둘 곳
+     * @param admission 연결 수와 요청 대기 시간을 세는 곳
+     * @return Service*
+     */
+    static Service* Acquire(asio::io_context& ioc, WorkerPools& workers,
+                            ServiceTracker& tracker,
+                            AdmissionControl& admission) {
+        Service* service = nullptr;
+        auto& pool       = LocalPool();
+        while (!service && !pool.empty()) {
+            service = pool.back();
+            pool.pop_back();
+            if (&service->m_sock.get_executor().context() != &ioc) {
+                delete service;
+                service = nullptr;
+            }
+        }
+        if (service) {
+            s_nPoolHits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            s_nPoolMisses.fetch_add(1, std::memory_order_relaxed);
+            service = new Service(ioc);
+        }
+        service->m_workers   = &workers;
+        service->m_tracker   = &tracker;
+        service->m_admission = &admission;
+        tracker.Add(service);
+        return service;
+    }
+
+    /**
+     * @brief 소켓을 닫고 버퍼를 비운 뒤 (capacity는 유지) 이 스레드의 free list에
+     * 돌려 놓는다.
+     *
+     * @param service
+     */
+    static void Release(Service* service) {
+        asio::error_code ignored;
+        service->m_sock.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+        service->m_sock.close(ignored);
+        service->m_reader.reset();
+        service->m_response.clear();
+        service->m_bFinishing = false;
+        service->m_bReading   = false;
+        service->m_bDraining  = false;
+        service->m_bAborted.store(false);
+        // Make room before the Service goes, Stop waits for the tracker only
+        if (service->m_bAdmitted) {
+            service->m_bAdmitted = false;
+            service->m_admission->Leave();
+        }
+        service->m_tracker->Remove(service);
+
+        auto& pool = LocalPool();
+        if (pool.size() < MAX_POOLED) {
+            pool.push_back(service);
+        } else {
+            delete service;
+        }
+    }
+
+    // Connections served by a recycled Service, and by a newly allocated one
+    static uint64_t PoolHits() { return s_nPoolHits.load(); }
+    static uint64_t PoolMisses() { return s_nPoolMisses.load(); }
+
+    /**
+     * @brief 연결을 시작하지 않은 (accept이 실패한) 서비스 객체를 strand에서 pool에 돌려
+     * 놓는다. 그 사이에 Drain/Abort가 strand에 들어와 있을 수 있기 때문이다.
+     *
+     * @param service
+     */
+    static void Discard(Service* service) {
+        asio::dispatch(service->m_strand, [service]() { Release(service); });
+    }
+
+    asio::ip::tcp::socket& Socket() { return m_sock; }
+
+    /**
+     * @brief 유휴 타이머를 걸고 첫 요청을 읽기 시작한다. 연결 수 제한 안에서 받아 들인
+     * (AdmissionControl::TryAdmit) 연결이어야 한다.
      * 
      */
     void StartHandling() {
-        asio::async_read_until(
-            *m_sock, m_request, '\n',
-            [this](const asio::error_code& ec, std::size_t bytes_transfered) {
-                OnRequestReceived(ec, bytes_transfered);
-            });
+        m_bAdmitted = true;
+        asio::dispatch(m_strand, [this]() {
+            ArmTimer();
+            if (m_bDraining) {
+                OnFinish();
+                return;
+            }
+            ReadRequest();
+        });
+    }
+
+    /**
+     * @brief 연결 수 제한에 걸린 연결에 BUSY_RESPONSE를 보내고 끝낸다. 요청은 처리하지
+     * 않고 Linger로 버린다.
+     * 
+     */
+    void StartRejecting() {
+        m_admission->CountRejected();
+        asio::dispatch(m_strand, [this]() {
+            ArmTimer();
+            asio::async_write(
+                m_sock, asio::buffer(BUSY_RESPONSE),
+                asio::bind_executor(m_strand, [this](const asio::error_code& ec,
+                                                     std::size_t) {
+                    if (ec) {
+                        OnFinish();
+                        return;
+                    }
+                    Linger();
+                }));
+        });
+    }
+
+    /**
+     * @brief 다음 요청을 받지 않고 지금 처리 중인 요청의 응답만 보낸 뒤 끝내게 한다.
+     * 요청을 기다리던 중이면 바로 끝난다. ServiceTracker::ForEach 안에서 부른다.
+     * 
+     */
+    void Drain() {
+        ServiceTracker* tracker = m_tracker;
+        asio::post(m_strand, [this, tracker]() {
+            // Finished (and maybe deleted) in the meantime
+            if (!tracker->Contains(this) || m_bFinishing) {
+                return;
+            }
+            m_bDraining = true;
+            if (m_bReading) {
+                asio::error_code ignored;
+                m_sock.cancel(ignored);
+            }
+        });
+    }
+
+    /**
+     * @brief 진행 중인 소켓 연산을 취소하고 처리 중인 요청의 응답은 보내지 않는다. 스레드
+     * 풀에서 처리 중인 요청들도 다음 단계에서 멈춘다. ServiceTracker::ForEach 안에서 부른다.
+     * 
+     */
+    void Abort() {
+        m_bAborted.store(true);
+        ServiceTracker* tracker = m_tracker;
+        asio::post(m_strand, [this, tracker]() {
+            if (!tracker->Contains(this) || m_bFinishing) {
+                return;
+            }
+            m_bDraining = true;
+            asio::error_code ignored;
+            m_sock.cancel(ignored);
+        });
     }
 
  private:
     /**
-     * @brief 요청을 받아들여 비정상이면 서비스를 종료하고 정상이면 ProcessRequest를 호출하여 요청을 처리한다. 
-     * 처리한 요청에 대한 응답을 비동기 쓰기 연산으로 서버로 보내고 비동기 연산이 어떻게든 종료되면 OnResponsesSent를 호출한다.
+     * @brief 연결이 끝날 때까지 걸려 있는 타이머를 건다. 서비스 객체는 그 핸들러
+     * (OnTimer)가 pool에 돌려 놓는다.
+     * 
+     */
+    void ArmTimer() {
+        m_tpDeadline = std::chrono::steady_clock::now() + IDLE_TIMEOUT;
+        m_timer.expires_at(m_tpDeadline);
+        m_timer.async_wait([this](const asio::error_code& ec) { OnTimer(ec); });
+    }
+
+    /**
+     * @brief 보내는 쪽을 닫고, 클라이언트가 닫을 때까지 (길어야 LINGER_TIMEOUT) 들어오는
+     * 데이터를 버린다. 읽지 않은 요청이 남은 소켓을 닫으면 RST가 나가서 클라이언트가
+     * BUSY_RESPONSE를 읽기 전에 잃을 수 있기 때문이다.
+     * 
+     */
+    void Linger() {
+        asio::error_code ignored;
+        m_sock.shutdown(asio::ip::tcp::socket::shutdown_send, ignored);
+        // OnTimer re-arms the timer for the new deadline, which cancels the
+        // read if the client does not close in time
+        m_tpDeadline = std::chrono::steady_clock::now() + LINGER_TIMEOUT;
+        m_timer.expires_at(m_tpDeadline);
+        // The response buffer is not used any more, discard into it
+        m_response.resize(512);
+        DiscardInput();
+    }
+
+    /**
+     * @brief 클라이언트가 닫거나 (EOF) 읽기가 취소될 때까지 읽고 버린 뒤 끝낸다.
+     * 
+     */
+    void DiscardInput() {
+        m_sock.async_read_some(
+            asio::buffer(m_response),
+            asio::bind_executor(m_strand, [this](const asio::error_code& ec,
+                                                 std::size_t) {
+                if (ec) {
+                    OnFinish();
+                    return;
+                }
+                DiscardInput();
+            }));
+    }
+
+    /**
+     * @brief 클라이언트에서 들어오는 비동기 요청을 읽고 OnRequestReceived를 호출하여 요청을 처리한다.
+     * 이미 받아 둔 데이터에 요청이 남아 있으면 바로 완료된다.
+     * 
+     */
+    void ReadRequest() {
+        m_bReading   = true;
+        m_tpDeadline = std::chrono::steady_clock::now() + IDLE_TIMEOUT;
+        TRACE_BEGIN("read request", reinterpret_cast<uintptr_t>(this));
+        m_reader.async_read_line(asio::bind_executor(
+            m_strand, [this](const asio::error_code& ec,
+                             std::string_view request) {
+                OnRequestReceived(ec, request);
+            }));
+    }
+
+    /**
+     * @brief 유휴 시간이 지났으면 소켓 연산을 취소해서 대기 중인 읽기를 끝낸다. 연결이 끝날
+     * 때까지 타이머를 다시 걸고, 연결이 끝나면 (OnFinish가 타이머를 취소) 서비스 객체를
+     * pool에 돌려 놓는다. 타이머 핸들러가 남아 있는 동안 객체를 재사용하지 않기 위해서다.
      * 
      * @param ec 
-     * @param bytes_transfered 
+     */
+    void OnTimer(const asio::error_code& ec) {
+        if (m_bFinishing) {
+            Release(this);
+            return;
+        }
+        if (!ec && std::chrono::steady_clock::now() >= m_tpDeadline) {
+            alog::debug("Idle connection closed");
+            asio::error_code ignored;
+            m_sock.cancel(ignored);
+            m_tpDeadline = std::chrono::steady_clock::time_point::max();
+        }
+        m_timer.expires_at(std::min(
+            m_tpDeadline, std::chrono::steady_clock::now() + IDLE_TIMEOUT));
+        m_timer.async_wait([this](const asio::error_code& ec) { OnTimer(ec); });
+    }
+
+    /**
+     * @brief 요청을 받아들여 비정상이면 서비스를 종료하고 정상이면 받아 둔 요청들의 처리를 cpu 풀에 넘긴다.
+     * 처리가 끝나면 (OnRequestsProcessed) 응답을 비동기 쓰기 연산으로 보낸다.
+     * 
+     * @param ec 
+     * @param request 첫 요청 (수신 버퍼 위의 view)
      */
     void OnRequestReceived(const asio::error_code& ec,
-                           std::size_t bytes_transfered) {
+                           std::string_view request) {
+        TRACE_END("read request", reinterpret_cast<uintptr_t>(this));
+        m_bReading = false;
         if (ec.value() != 0) {
-            std::cout << "Error occured! Error code = " << ec.value()
-                      << ". Message: " << ec.message();
+            // The client closing the connection or going idle is the normal
+            // end of a keep-alive connection
+            if (ec != asio::error::eof &&
+                ec != asio::error::operation_aborted) {
+                alog::warn("Error occured! Error code = ", ec.value(),
+                           ". Message: ", ec.message());
+            }
 
             OnFinish();
             return;
         }
+        m_tpDeadline = std::chrono::steady_clock::time_point::max();
+
+        // Take every other complete request that came with it. The views stay
+        // valid until the next read, which is after the response is sent.
+        m_vecRequests.clear();
+        m_vecRequests.push_back(request);
+        while (auto next = m_reader.try_get_line()) {
+            m_vecRequests.push_back(*next);
+        }
+
+        // Nothing else touches the buffers until the result is posted back
+        m_tpQueued = std::chrono::steady_clock::now();
+        asio::post(m_workers->cpu, [this]() { ProcessRequests(); });
+    }
+
+    /**
+     * @brief CPU POOL - 받아 둔 요청을 모두 순서대로 처리하고, 스레드를 재우는 나머지 작업은
+     * blocking 풀에 넘긴다. 두 풀의 큐에서 기다린 시간이 CoDel이 보는 대기 시간이다.
+     * 
+     */
+    void ProcessRequests() {
+        auto tpStart = std::chrono::steady_clock::now();
+        m_queueWait  = tpStart - m_tpQueued;
+
+        for (std::string_view request : m_vecRequests) {
+            if (m_bAborted.load()) {
+                break;
+            }
+            ProcessRequest(request, m_response);
+        }
+        size_t nRequests = m_vecRequests.size();
+
+        m_tpQueued = std::chrono::steady_clock::now();
+        asio::post(m_workers->blocking, [this, nRequests]() {
+            auto wait =
+                m_queueWait + (std::chrono::steady_clock::now() - m_tpQueued);
+            if (m_admission->ShouldShed(wait)) {
+                ShedRequests(nRequests);
+            } else {
+                for (size_t i = 0; i < nRequests && !m_bAborted.load(); i++) {
+                    BlockingWork();
+                }
+            }
+            asio::post(m_strand, [this]() { OnRequestsProcessed(); });
+        });
+    }
+
+    /**
+     * @brief BLOCKING POOL - 처리한 요청들의 응답을 BUSY_RESPONSE로 바꾼다. 응답 수는
+     * 요청 수와 같게 유지한다.
+     * 
+     * @param nRequests 
+     */
+    void ShedRequests(size_t nRequests) {
+        TRACE_INSTANT("shed");
+        m_admission->CountShed(nRequests);
+        m_response.clear();
+        for (size_t i = 0; i < nRequests; i++) {
+            m_response.append(BUSY_RESPONSE);
+        }
+    }
 
-        // Process the request.
-        m_response = ProcessRequest(m_request);
+    /**
+     * @brief 처리한 요청들에 대한 응답을 비동기 쓰기 연산으로 보내고 비동기 연산이 어떻게든
+     * 종료되면 OnResponsesSent를 호출한다.
+     * 
+     */
+    void OnRequestsProcessed() {
+        if (m_bAborted.load()) {
+            OnFinish();
+            return;
+        }
 
         // Initiate asynchronous write operation.
+        TRACE_BEGIN("write response", reinterpret_cast<uintptr_t>(this));
         asio::async_write(
-            *m_sock, asio::buffer(m_response),
-            [this](const asio::error_code& ec, std::size_t bytes_transferred) {
-                OnResponseSent(ec, bytes_transferred);
-            });
+            m_sock, asio::buffer(m_response),
+            asio::bind_executor(
+                m_strand, [this](const asio::error_code& ec,
+                                 std::size_t bytes_transferred) {
+                    OnResponseSent(ec, bytes_transferred);
+                }));
     }
 
     /**
-     * @brief 응답이 정상적으로 보내졌으면 서비스를 종료하고 아니면 추가로 오류를 출력한다.
+     * @brief 응답이 정상적으로 보내졌으면 다음 요청을 읽고 아니면 오류를 출력하고 서비스를 종료한다.
      * 
      * @param ec 
      * @param bytes_transfered 
      */
     void OnResponseSent(const asio::error_code& ec,
                         std::size_t bytes_transfered) {
+        TRACE_END("write response", reinterpret_cast<uintptr_t>(this));
         if (ec.value() != 0) {
-            std::cout << "Error occured! Error "
-                         "code = "
-                      << ec.value() << ". Message: " << ec.message();
+            alog::warn("Error occured! Error code = ", ec.value(),
+                       ". Message: ", ec.message());
+
+            OnFinish();
+            return;
         }
 
-        OnFinish();
+        m_response.clear();
+        if (m_bDraining) {
+            OnFinish();
+            return;
+        }
+        ReadRequest();
     }
 
     /**
-     * @brief 서비스 객체를 헤제한다.
+     * @brief 타이머를 취소한다. 서비스 객체는 타이머 핸들러가 pool에 돌려 놓는다.
      * 
      */
-    void OnFinish() { delete this; }
+    void OnFinish() {
+        m_bFinishing = true;
+        m_timer.cancel();
+    }
 
     /**
-     * @brief 요청에 대한 처리를 모사한다.
+     * @brief CPU POOL - 요청에 대한 처리를 모사한다.
      * 
-     * @param request 
-     * @return std::string 
+     * @param request 개행을 뺀 요청 한 줄
+     * @param response 응답을 덧붙일 버퍼 (이전 연결의 capacity를 그대로 쓴다)
      */
-    std::string ProcessRequest(asio::streambuf& request) {
+    void ProcessRequest(std::string_view request, std::string& response) {
         // In this method we parse the request, process it and prepare the request.
+        TRACE_SCOPE("ProcessRequest");
 
         // Emulate CPU-consuming operations.
         int i = 0;
         while (i != 1000000) i++;
 
+        // Append the response message.
+        response.append("Response\n");
+    }
+
+    /**
+     * @brief BLOCKING POOL - 요청 하나에 따르는, 스레드를 재우는 작업을 모사한다.
+     * 
+     */
+    static void BlockingWork() {
+        TRACE_SCOPE("BlockingWork");
+
         // Emulate operations that block the thread
         // (e.g. synch I/O operations).
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
 
-        // Prepare and return the response message.
-        std::string response = "Response\n";
-        return response;
+    // Frees the pooled objects when the thread exits
+    struct free_list : std::vector<Service*> {
+        ~free_list() {
+            for (Service* service : *this) {
+                delete service;
+            }
+        }
+    };
+
+    static free_list& LocalPool() {
+        thread_local free_list tls_pool;
+        return tls_pool;
     }
 
-    std::shared_ptr<asio::ip::tcp::socket> m_sock;
+    static inline std::atomic<uint64_t> s_nPoolHits{0};
+    static inline std::atomic<uint64_t> s_nPoolMisses{0};
+
+    asio::ip::tcp::socket m_sock;
+    asio::strand<asio::io_context::executor_type> m_strand;
+    asio::steady_timer m_timer;
+    WorkerPools* m_workers        = nullptr;
+    ServiceTracker* m_tracker     = nullptr;
+    AdmissionControl* m_admission = nullptr;
+    // Counted in AdmissionControl until Release
+    bool m_bAdmitted = false;
+    // Time the requests have waited in the pool queues, handed on with them
+    std::chrono::steady_clock::time_point m_tpQueued;
+    std::chrono::steady_clock::duration m_queueWait{};
+    // State on the strand
+    bool m_bReading  = false;
+    bool m_bDraining = false;
+    // Also read by the pools, to give up on the rest of the requests
+    std::atomic<bool> m_bAborted{false};
+    std::chrono::steady_clock::time_point m_tpDeadline;
+    bool m_bFinishing = false;
     std::string m_response;
-    asio::streambuf m_request;
+    lineio::line_reader<asio::ip::tcp::socket> m_reader;
+    std::vector<std::string_view> m_vecRequests;
 };
 
 class Acceptor {
  public:
-    Acceptor(asio::io_context& ioc, unsigned short port_num)
+    Acceptor(asio::io_context& ioc, WorkerPools& workers,
+             ServiceTracker& tracker, AdmissionControl& admission,
+             unsigned short port_num)
         : m_ioc(ioc),
-          m_acceptor(m_ioc, asio::ip::tcp::endpoint(asio::ip::address_v4::any(),
-                                                    port_num)),
-          m_is_stopped(false) {}
+          m_workers(workers),
+          m_tracker(tracker),
+          m_admission(admission),
+          // On a strand, so that Stop can close it while an accept is pending
+          m_acceptor(asio::make_strand(m_ioc),
+                     asio::ip::tcp::endpoint(asio::ip::address_v4::any(),
+                                             port_num)),
+          m_is_stopped(false) {
+        m_admission.SetResume([this]() {
+            asio::post(m_acceptor.get_executor(), [this]() {
+                if (!m_is_stopped.load()) {
+                    InitAccept();
+                }
+            });
+        });
+    }
 
     /**
      * @brief 수용자 소켓이 클라이언트의 연결 수립 요청을 들을 수 있도록 listen 상태로 변경하고 InitAccept을 호출한다.
@@ -136,104 +803,204 @@ class Acceptor {
         InitAccept();
     }
 
-    void Stop() { m_is_stopped.store(true); }
+    /**
+     * @brief 수용자 소켓을 바로 닫는다. 대기 중인 async_accept는 operation_aborted로 끝나고
+     * 다시 시작되지 않는다.
+     * 
+     */
+    void Stop() {
+        asio::post(m_acceptor.get_executor(), [this]() {
+            m_is_stopped.store(true);
+            asio::error_code ignored;
+            m_acceptor.close(ignored);
+        });
+    }
 
  private:
     /**
-     * @brief 소켓 객체를 힙에 만들고 async_accept을 수행한다.
+     * @brief pool에서 서비스 객체를 꺼내 그 소켓으로 async_accept을 수행한다.
      * 
      */
     void InitAccept() {
-        std::shared_ptr<asio::ip::tcp::socket> sock(
-            new asio::ip::tcp::socket(m_ioc));
+        Service* service =
+            Service::Acquire(m_ioc, m_workers, m_tracker, m_admission);
 
-        m_acceptor.async_accept(*sock,
-                                [this, sock](const asio::error_code& error) {
-                                    OnAccept(error, sock);
+        m_acceptor.async_accept(service->Socket(),
+                                [this, service](const asio::error_code& error) {
+                                    OnAccept(error, service);
                                 });
     }
 
     /**
      * @brief async_accept가 어떻게든 종료되었을 때 호출되는 콜백함수, 정상이면 서비스 객체를 생성하여 비동기 요청 읽기 연산을 시작한다.
+     * 연결 수 제한에 걸렸으면 BUSY_RESPONSE로 거절한다.
      * 중단 명령이 들어왔는지 플래그를 확인하고 중단 명령이 들어오지 않았으면 다시 연결 수립할 수 있도록 대기히기 위해 InitAccept()를 호출한다. 중단 명령이 들어왔으면 수용자 소켓을 닫는다.
+     * 연결 수가 가득 찼고 거절하지 않는 정책이면 연결 하나가 끝날 때까지 accept을 쉰다.
      * @param ec 
-     * @param sock 
+     * @param service 
      */
-    void OnAccept(const asio::error_code& ec,
-                  std::shared_ptr<asio::ip::tcp::socket> sock) {
+    void OnAccept(const asio::error_code& ec, Service* service) {
+        TRACE_SCOPE("OnAccept");
         if (ec.value() == 0) {
-            (new Service(sock))->StartHandling();
+            if (m_admission.TryAdmit()) {
+                service->StartHandling();
+            } else {
+                service->StartRejecting();
+            }
         } else {
-            std::cout << "Error occured! Error code = " << ec.value()
-                      << ". Message: " << ec.message();
+            if (!m_is_stopped.load()) {
+                alog::warn("Error occured! Error code = ", ec.value(),
+                           ". Message: ", ec.message());
+            }
+            Service::Discard(service);
         }
 
         // Init next async accept operation if
         // acceptor has not been stopped yet.
         if (!m_is_stopped.load()) {
+            // Leave new clients in the listen backlog until one ends
+            if (!m_admission.Policy().reject_when_full &&
+                m_admission.Full() && m_admission.Pause()) {
+                return;
+            }
             InitAccept();
         } else {
             // Stop accepting incoming connections
             // and free allocated resources.
-            m_acceptor.close();
+            asio::error_code ignored;
+            m_acceptor.close(ignored);
         }
     }
 
     asio::io_context& m_ioc;
+    WorkerPools& m_workers;
+    ServiceTracker& m_tracker;
+    AdmissionControl& m_admission;
     asio::ip::tcp::acceptor m_acceptor;
     std::atomic<bool> m_is_stopped;
 };
 
 class Server {
  public:
+    // How long Stop lets active connections finish their current request
+    static constexpr auto DRAIN_TIMEOUT = std::chrono::seconds(5);
+    // How long Stop then waits for aborted connections to hand back their
+    // Service
+    static constexpr auto ABORT_GRACE = std::chrono::seconds(1);
+
     Server() {
         m_work = std::make_unique<work_guard_type>(m_ioc.get_executor());
     }
 
     /**
-     * @brief 서버를 시작한다. 수용자 객체를 생성하고 시작한다. 스레드 풀을 이용하여 비동기 연산이 병렬로 처리될 수 있도록 한다.
+     * @brief 동시 연결 수 제한과 요청 거절 (load shedding) 정책을 정한다. Start 전에 부른다.
+     * 
+     * @param policy 
+     */
+    void SetAdmissionPolicy(const AdmissionPolicy& policy) {
+        m_admissionPolicy = policy;
+    }
+
+    /**
+     * @brief 서버를 시작한다. 요청을 처리할 스레드 풀들과 수용자 객체를 생성하고 시작한다. 스레드 풀을 이용하여 비동기 연산이 병렬로 처리될 수 있도록 한다.
      * 
      * @param port_num 
-     * @param thread_pool_size 
+     * @param thread_pool_size io_context를 돌리는 스레드 수 (코어 수면 충분하다)
+     * @param cpu_pool_size 요청을 계산하는 스레드 수
+     * @param blocking_pool_size 스레드를 재우는 작업을 하는 스레드 수
+     * @param io_placement io 스레드를 고정할 CPU들과 스레드 이름
      */
-    void Start(unsigned short port_num, unsigned int thread_pool_size) {
+    void Start(unsigned short port_num, unsigned int thread_pool_size,
+               unsigned int cpu_pool_size, unsigned int blocking_pool_size,
+               const iothreads::placement& io_placement =
+                   iothreads::placement()) {
         assert(thread_pool_size > 0);
 
+        m_workers =
+            std::make_unique<WorkerPools>(cpu_pool_size, blocking_pool_size);
+        m_admission = std::make_unique<AdmissionControl>(m_admissionPolicy);
+
         // Create and start Acceptor.
-        acc = std::make_unique<Acceptor>(m_ioc, port_num);
+        acc = std::make_unique<Acceptor>(m_ioc, *m_workers, m_tracker,
+                                         *m_admission, port_num);
         acc->Start();
 
         // Create specified number of threads and
-        // add them to the pool.
-        for (unsigned int i = 0; i < thread_pool_size; i++) {
-            std::unique_ptr<std::thread> th(
-                new std::thread([this]() { m_ioc.run(); }));
-
-            m_thread_pool.push_back(std::move(th));
-        }
+        // add them to the pool. Each one is pinned and named before it runs
+        // the io_context, so its Service pool is allocated on its own node.
+        m_thread_pool = std::make_unique<iothreads::io_thread_pool>(
+            io_placement);
+        m_thread_pool->run(m_ioc, thread_pool_size);
     }
 
     /**
-     * @brief 서버를 중단시칸다. 수용자 객체를 중단하고 io_context를 중단한 후, 스레드 풀의 스레드들을 join한다.
+     * @brief 서버를 중단시칸다. 수용자 객체를 중단하고, 서비스 객체들이 처리 중인 요청을 마치고
+     * 돌아오기를 drain_timeout까지 기다린다. 그 뒤에도 남은 연결은 취소하고 모두 돌아오거나
+     * ABORT_GRACE가 지날 때까지 더 기다린다. 그 다음 io_context를 중단하고 스레드 풀의
+     * 스레드들을 join한 뒤, 요청을 처리하던 스레드 풀들도 (남은 작업은 버리고) 멈춘다.
+     * 끝내 돌아오지 않은 서비스 객체는 그 다음에 해제한다.
      * 
+     * @param drain_timeout 
      */
-    void Stop() {
+    void Stop(std::chrono::milliseconds drain_timeout = DRAIN_TIMEOUT) {
         acc->Stop();
+
+        m_tracker.ForEach([](Service* service) { service->Drain(); });
+        auto deadline = std::chrono::steady_clock::now() + drain_timeout;
+        if (!m_tracker.WaitEmpty(deadline)) {
+            alog::warn(m_tracker.Count(),
+                       " connections still busy at the deadline, aborting");
+            m_tracker.ForEach([](Service* service) { service->Abort(); });
+
+            // Aborted work gives up at its next step and hands its Service
+            // back through the io threads, so the pools and io threads keep
+            // running until then. Work still queued behind it must not hold
+            // Stop past the grace period, it is dropped by Stop below.
+            m_tracker.WaitEmpty(std::chrono::steady_clock::now() +
+                                ABORT_GRACE);
+        }
+
         m_ioc.stop();
 
-        for (auto& th : m_thread_pool) {
-            th->join();
+        m_thread_pool->join();
+        m_workers->Stop();
+
+        // No thread runs their handlers any more, so whatever did not come
+        // back is freed here
+        std::vector<Service*> vecLeftover = m_tracker.TakeAll();
+        if (!vecLeftover.empty()) {
+            alog::warn(vecLeftover.size(), " services did not finish");
+        }
+        for (Service* service : vecLeftover) {
+            delete service;
         }
+
+        uint64_t hits   = Service::PoolHits();
+        uint64_t misses = Service::PoolMisses();
+        alog::info("Service pool: ", hits, " hits, ", misses, " misses (",
+                   hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0,
+                   "% hit rate)");
+        alog::info("Admission: ", m_admission->Rejected(),
+                   " connections rejected, ", m_admission->Pauses(),
+                   " accept pauses, ", m_admission->Shed(), " requests shed");
     }
 
  private:
     asio::io_context m_ioc;
     std::unique_ptr<work_guard_type> m_work = nullptr;
+    std::unique_ptr<WorkerPools> m_workers;
+    AdmissionPolicy m_admissionPolicy;
+    std::unique_ptr<AdmissionControl> m_admission;
+    ServiceTracker m_tracker;
     std::unique_ptr<Acceptor> acc;
-    std::vector<std::unique_ptr<std::thread>> m_thread_pool;
+    std::unique_ptr<iothreads::io_thread_pool> m_thread_pool;
 };
 
 const unsigned int DEFAULT_THREAD_POOL_SIZE = 2;
+// Each blocking request holds a thread for 100 ms
+const unsigned int BLOCKING_POOL_SIZE = 32;
+// Connections served at once, the rest wait in the listen backlog
+const size_t MAX_SERVICES = 1000;
 
 int main() {
     unsigned short port_num = 3333;
@@ -241,20 +1008,31 @@ int main() {
     try {
         Server srv;
 
-        unsigned int thread_pool_size = std::thread::hardware_concurrency() * 2;
+        AdmissionPolicy policy;
+        policy.max_services = MAX_SERVICES;
+        srv.SetAdmissionPolicy(policy);
+
+        // Request processing never runs on the io threads, so one per core
+        unsigned int thread_pool_size = std::thread::hardware_concurrency();
 
         if (thread_pool_size == 0) {
             thread_pool_size = DEFAULT_THREAD_POOL_SIZE;
         }
 
-        srv.Start(port_num, thread_pool_size);
+        // e.g. IO_CPUS=0-7 to keep the io threads on the first socket
+        srv.Start(port_num, thread_pool_size, thread_pool_size,
+                  BLOCKING_POOL_SIZE,
+                  iothreads::placement::from_env("IO_CPUS", "srv-io"));
 
         std::this_thread::sleep_for(std::chrono::seconds(60));
 
         srv.Stop();
+
+        // Only writes a file when built with ENABLE_TRACE
+        TRACE_DUMP("async_parallel_tcp_server.trace.json");
     } catch (asio::system_error& e) {
-        std::cout << "Error occured! Error code = " << e.code()
-                  << ". Message: " << e.what();
+        alog::error("Error occured! Error code = ", e.code(),
+                    ". Message: ", e.what());
     }
 
     return 0;
@@ -0,0 +1,399 @@
+/**
+ * @file async_log.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief I/O 스레드를 막지 않는 로그 (스레드 별 링 + 출력 전담 스레드)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+//* 로그를 남기는 스레드는 자신의 링에 한 줄을 써넣기만 하고 (잠금, 할당,
+//* system call 없음), 출력은 백그라운드 스레드가 LOG_INTERVAL마다 모든 링을
+//* 비우며 시간 순으로 정렬해서 한다. 따라서 stdout이 막혀도 asio 스레드는
+//* 멈추지 않는다. 대신
+//*   - 한 줄은 LINE_BYTES 바이트에서 잘린다.
+//*   - 링이 가득 차면 그 줄은 버린다.
+//*   - 스레드마다 초당 줄 수를 token bucket으로 제한한다 (error는 제외).
+//* 버린 줄의 수는 나중에 한 줄로 보고한다.
+//* 스레드가 끝나면 그 링은 은퇴 표시만 하고, 출력 스레드가 마지막으로 비운
+//* 뒤에 해제한다. logger는 일부러 해제하지 않으므로 (static 소멸자 등) 늦게
+//* 남기는 로그도 안전하고, 프로세스가 끝날 때 (atexit) 출력 스레드를 멈추고
+//* 남은 줄을 모두 쓴다. 그 뒤의 로그는 호출한 스레드에서 바로 쓴다.
+//*
+//*   alog::info("[SERVER] New Connection: ", endpoint);
+//*   alog::error("[", id, "] Read Header Fail.");
+//*
+//* 인자는 operator<<로 이어 붙인다. 줄 끝의 개행은 붙이지 않는다.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace alog {
+
+enum class level : uint8_t { debug = 0, info = 1, warn = 2, error = 3 };
+
+namespace detail {
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+struct line {
+    static constexpr size_t LINE_BYTES = 256;
+
+    uint64_t time_ns;
+    level lvl;
+    uint16_t length;
+    char text[LINE_BYTES];
+};
+
+// Formats straight into a line, whatever does not fit is cut off
+class line_buf : public std::streambuf {
+ public:
+    void reset(char* p, size_t n) { setp(p, p + n); }
+    size_t length() const { return static_cast<size_t>(pptr() - pbase()); }
+};
+
+//* 한 스레드의 링 (single producer, single consumer). head는 로그를 남기는
+//* 스레드만, tail은 출력 스레드만 올린다.
+class thread_ring {
+ public:
+    static constexpr size_t CAPACITY = 1024;
+
+    thread_ring() : m_lines(CAPACITY) {}
+
+    // OWNING THREAD - the next free line, or nullptr if the ring is full
+    line* reserve() {
+        uint64_t head = m_nHead.load(std::memory_order_relaxed);
+        if (head - m_nTail.load(std::memory_order_acquire) >= CAPACITY) {
+            return nullptr;
+        }
+        return &m_lines[head % CAPACITY];
+    }
+
+    // OWNING THREAD - hand the reserved line to the output thread
+    void commit() {
+        m_nHead.store(m_nHead.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+    }
+
+    // OUTPUT THREAD
+    template <typename Fn>
+    void drain(Fn fn) {
+        uint64_t tail = m_nTail.load(std::memory_order_relaxed);
+        uint64_t head = m_nHead.load(std::memory_order_acquire);
+        for (; tail < head; tail++) {
+            fn(m_lines[tail % CAPACITY]);
+        }
+        m_nTail.store(tail, std::memory_order_release);
+    }
+
+    // Lines lost to a full ring or to the rate limit, taken by the output
+    // thread
+    std::atomic<uint64_t> dropped{0};
+
+    // Set once the owning thread has exited, the output thread frees the ring
+    // after it has drained it one last time
+    std::atomic<bool> retired{false};
+
+    // Token bucket, owning thread only
+    double tokens = -1.0;
+    uint64_t last_refill_ns = 0;
+
+ private:
+    std::vector<line> m_lines;
+    alignas(64) std::atomic<uint64_t> m_nHead{0};
+    alignas(64) std::atomic<uint64_t> m_nTail{0};
+};
+
+class logger {
+ public:
+    static constexpr auto LOG_INTERVAL = std::chrono::milliseconds(10);
+
+    // Never destroyed, so that threads and static destructors may log until
+    // the very end
+    static logger& get() {
+        static logger* s_logger = new logger;
+        return *s_logger;
+    }
+
+    logger(const logger&) = delete;
+
+    std::atomic<level> min_level{level::info};
+    std::atomic<level> stderr_level{level::warn};
+    std::atomic<double> rate{1000.0};
+    std::atomic<double> burst{2000.0};
+
+    template <typename... Args>
+    void write(level lvl, const Args&... args) {
+        if (thread_ring* ring = local()) {
+            Write(*ring, Stream(), StreamBuf(), lvl, args...);
+        } else {
+            // The thread is exiting and its stream may be gone already
+            line_buf buf;
+            std::ostream os(&buf);
+            std::scoped_lock lock(m_muxRings);
+            Write(m_orphanRing, os, buf, lvl, args...);
+        }
+        if (m_bShutDown.load(std::memory_order_acquire)) {
+            flush();
+        }
+    }
+
+    // Write out everything logged so far, on the calling thread
+    void flush() {
+        std::scoped_lock lock(m_muxDrain);
+        Drain();
+    }
+
+ private:
+    logger() {
+        m_thread = std::thread([this]() { Run(); });
+        std::atexit([]() { get().ShutDown(); });
+    }
+
+    // Retires the ring of the thread when the thread exits
+    struct ring_retirer {
+        ~ring_retirer() {
+            tls_bExiting = true;
+            tls_ring     = nullptr;
+            if (ring) {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+        thread_ring* ring = nullptr;
+    };
+
+    // The ring of the calling thread, nullptr once the thread is exiting
+    thread_ring* local() {
+        if (!tls_ring && !tls_bExiting) {
+            auto ring = std::make_unique<thread_ring>();
+            tls_ring  = ring.get();
+            {
+                std::scoped_lock lock(m_muxRings);
+                m_vecRings.push_back(std::move(ring));
+            }
+            thread_local ring_retirer tls_retirer;
+            tls_retirer.ring = tls_ring;
+        }
+        return tls_ring;
+    }
+
+    // A stream per thread that formats into a line
+    static line_buf& StreamBuf() {
+        thread_local line_buf tls_buf;
+        return tls_buf;
+    }
+
+    static std::ostream& Stream() {
+        thread_local std::ostream tls_os(&StreamBuf());
+        return tls_os;
+    }
+
+    template <typename... Args>
+    void Write(thread_ring& ring, std::ostream& os, line_buf& buf, level lvl,
+               const Args&... args) {
+        if (lvl < level::error && !TakeToken(ring)) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        line* l = ring.reserve();
+        if (!l) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buf.reset(l->text, line::LINE_BYTES);
+        os.clear();
+        (os << ... << args);
+        l->length  = static_cast<uint16_t>(buf.length());
+        l->time_ns = now_ns();
+        l->lvl     = lvl;
+        ring.commit();
+    }
+
+    // AT EXIT - stop the output thread after it has written everything
+    void ShutDown() {
+        {
+            std::scoped_lock lock(m_muxWake);
+            m_bStop = true;
+        }
+        m_cvWake.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        m_bShutDown.store(true, std::memory_order_release);
+        flush();
+    }
+
+    bool TakeToken(thread_ring& ring) {
+        double r = rate.load(std::memory_order_relaxed);
+        double b = burst.load(std::memory_order_relaxed);
+        if (r <= 0.0) {
+            return true;
+        }
+        uint64_t now = now_ns();
+        if (ring.tokens < 0.0) {
+            ring.tokens = b;
+        } else {
+            double elapsed = double(now - ring.last_refill_ns) * 1e-9;
+            ring.tokens    = std::min(b, ring.tokens + elapsed * r);
+        }
+        ring.last_refill_ns = now;
+        if (ring.tokens < 1.0) {
+            return false;
+        }
+        ring.tokens -= 1.0;
+        return true;
+    }
+
+    // OUTPUT THREAD
+    void Run() {
+        std::unique_lock lock(m_muxWake);
+        while (!m_bStop) {
+            m_cvWake.wait_for(lock, LOG_INTERVAL);
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+        lock.unlock();
+        flush();
+    }
+
+    // Lines of all threads in time order, from stderr_level up to stderr
+    void Drain() {
+        uint64_t nDropped = 0;
+        auto collect = [this, &nDropped](thread_ring& ring) {
+            ring.drain([this](const line& l) { m_vecBatch.push_back(l); });
+            nDropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+        };
+        {
+            std::scoped_lock lock(m_muxRings);
+            for (auto it = m_vecRings.begin(); it != m_vecRings.end();) {
+                // Whatever a retired ring holds was written before it retired
+                bool bRetired = (*it)->retired.load(std::memory_order_acquire);
+                collect(**it);
+                if (bRetired) {
+                    it = m_vecRings.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            collect(m_orphanRing);
+        }
+        std::stable_sort(m_vecBatch.begin(), m_vecBatch.end(),
+                         [](const line& a, const line& b) {
+                             return a.time_ns < b.time_ns;
+                         });
+
+        bool bOut = false;
+        bool bErr = false;
+        level errLevel = stderr_level.load(std::memory_order_relaxed);
+        for (const line& l : m_vecBatch) {
+            FILE* f = l.lvl >= errLevel ? stderr : stdout;
+            std::fwrite(l.text, 1, l.length, f);
+            std::fputc('\n', f);
+            (f == stdout ? bOut : bErr) = true;
+        }
+        m_vecBatch.clear();
+        if (nDropped > 0) {
+            std::fprintf(stderr, "[LOG] %llu lines dropped\n",
+                         static_cast<unsigned long long>(nDropped));
+            bErr = true;
+        }
+        if (bOut) {
+            std::fflush(stdout);
+        }
+        if (bErr) {
+            std::fflush(stderr);
+        }
+    }
+
+    static inline thread_local thread_ring* tls_ring = nullptr;
+    static inline thread_local bool tls_bExiting   = false;
+
+    std::mutex m_muxRings;
+    std::vector<std::unique_ptr<thread_ring>> m_vecRings;
+    // Shared by threads that log while they exit, under m_muxRings
+    thread_ring m_orphanRing;
+
+    std::mutex m_muxDrain;
+    std::vector<line> m_vecBatch;
+
+    std::mutex m_muxWake;
+    std::condition_variable m_cvWake;
+    bool m_bStop = false;
+    std::thread m_thread;
+    std::atomic<bool> m_bShutDown{false};
+};
+
+}  // namespace detail
+
+// Lines below this level are not even formatted
+inline void set_level(level lvl) {
+    detail::logger::get().min_level.store(lvl, std::memory_order_relaxed);
+}
+
+// Lines of this level and above go to stderr, the rest to stdout. Warnings
+// and errors by default, level::debug keeps stdout free for a program's
+// own output.
+inline void set_stderr_level(level lvl) {
+    detail::logger::get().stderr_level.store(lvl, std::memory_order_relaxed);
+}
+
+// Lines per second each thread may log below the error level, with up to
+// burst saved up. A rate of 0 turns the limit off.
+inline void set_rate_limit(double rate, double burst) {
+    detail::logger::get().rate.store(rate, std::memory_order_relaxed);
+    detail::logger::get().burst.store(burst, std::memory_order_relaxed);
+}
+
+inline void flush() { detail::logger::get().flush(); }
+
+template <typename... Args>
+void log(level lvl, const Args&... args) {
+    auto& logger = detail::logger::get();
+    if (lvl >= logger.min_level.load(std::memory_order_relaxed)) {
+        logger.write(lvl, args...);
+    }
+}
+
+template <typename... Args>
+void debug(const Args&... args) {
+    log(level::debug, args...);
+}
+
+template <typename... Args>
+void info(const Args&... args) {
+    log(level::info, args...);
+}
+
+template <typename... Args>
+void warn(const Args&... args) {
+    log(level::warn, args...);
+}
+
+template <typename... Args>
+void error(const Args&... args) {
+    log(level::error, args...);
+}
+
+}  // namespace alog
@@ -0,0 +1,225 @@
+/**
+ * @file io_threads.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 지정한 CPU에 고정되고 이름이 붙은 io 스레드 풀 (NUMA 노드 로컬 메모리)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+//* 그냥 만든 std::thread는 스케줄러가 코어와 소켓 사이로 옮기므로, 멀티 소켓
+//* 장비에서는 캐시와 NUMA 지역성을 잃는다. io_thread_pool이 만드는 스레드는
+//* 시작하자마자 (Linux에서)
+//*   - placement::cpus 중 자기 순번의 CPU에 고정하고,
+//*   - 그 CPU가 속한 노드를 메모리 정책 (MPOL_PREFERRED)으로 정하고,
+//*   - "<name>-<순번>"으로 이름을 붙인 뒤 (top -H, perf, gdb에 보인다)
+//* 넘겨 받은 함수를 실행한다. 메모리 정책은 스레드가 처음 건드린 페이지에
+//* 적용되므로 그 스레드의 thread_local 버퍼, 객체 풀, 수신 버퍼 등은 별도의
+//* 할당자 없이 로컬 노드에 놓인다. cpus가 비어 있으면 고정하지 않고 이름만
+//* 붙인다. 다른 플랫폼에서는 평범한 std::thread와 같다.
+//*
+//*   iothreads::io_thread_pool pool(iothreads::placement::from_env("IO_CPUS"));
+//*   pool.run(ioc, 4);   // IO_CPUS=0-3,8-11
+//*   ...
+//*   pool.join();
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "async_log.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace iothreads {
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}. Malformed parts are skipped.
+inline std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string part(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view()
+                                               : list.substr(comma + 1);
+
+        char* end = nullptr;
+        long first = std::strtol(part.c_str(), &end, 10);
+        if (end == part.c_str() || first < 0) {
+            continue;
+        }
+        long last = first;
+        if (*end == '-') {
+            const char* second = end + 1;
+            last = std::strtol(second, &end, 10);
+            if (end == second || last < first) {
+                continue;
+            }
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+// Where the threads of a pool run and what they are called
+struct placement {
+    // Thread i is pinned to cpus[i % cpus.size()], empty leaves them unpinned
+    std::vector<int> cpus;
+    // Threads are named "<name>-<i>", cut to 15 characters on Linux
+    std::string name = "io";
+    // Prefer the node of the pinned CPU for the thread's memory
+    bool local_memory = true;
+
+    // The CPU list in the environment variable (see parse_cpu_list), or
+    // unpinned if it is not set
+    static placement from_env(const char* variable, std::string name = "io") {
+        placement p;
+        p.name = std::move(name);
+        if (const char* value = std::getenv(variable)) {
+            p.cpus = parse_cpu_list(value);
+        }
+        return p;
+    }
+};
+
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+inline void name_current_thread(const std::string& name) {
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#else
+    (void)name;
+#endif
+}
+
+// NUMA node of the CPU the calling thread runs on, -1 if unknown
+inline int current_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu  = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return -1;
+    }
+    return static_cast<int>(node);
+#else
+    return -1;
+#endif
+}
+
+// Pages the calling thread touches from now on come from its current node
+// while that node has free memory. Only makes sense on a pinned thread.
+inline bool prefer_local_node() {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    constexpr int MPOL_PREFERRED_ = 1;
+    constexpr size_t MAX_NODES    = 1024;
+    constexpr size_t BITS         = 8 * sizeof(unsigned long);
+
+    int node = current_node();
+    if (node < 0 || static_cast<size_t>(node) >= MAX_NODES) {
+        return false;
+    }
+    unsigned long mask[MAX_NODES / BITS] = {};
+    mask[node / BITS] = 1UL << (node % BITS);
+    // The kernel takes one more than the number of bits in the mask
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED_, mask, MAX_NODES + 1) ==
+           0;
+#else
+    return false;
+#endif
+}
+
+class io_thread_pool {
+ public:
+    explicit io_thread_pool(placement p = placement())
+        : m_placement(std::move(p)) {}
+
+    io_thread_pool(const io_thread_pool&) = delete;
+
+    // The threads must have been asked to return (e.g. io_context::stop)
+    ~io_thread_pool() { join(); }
+
+    // Start one more thread that runs fn once it is placed
+    template <typename Fn>
+    void spawn(Fn fn) {
+        size_t index = m_vecThreads.size();
+        m_vecThreads.emplace_back([this, index, fn = std::move(fn)]() mutable {
+            Place(index);
+            fn();
+        });
+    }
+
+    // Start nThreads threads that run the context
+    void run(asio::io_context& context, size_t nThreads) {
+        for (size_t i = 0; i < nThreads; i++) {
+            spawn([&context]() { context.run(); });
+        }
+    }
+
+    void join() {
+        for (auto& thread : m_vecThreads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        m_vecThreads.clear();
+    }
+
+    size_t size() const { return m_vecThreads.size(); }
+
+    const placement& get_placement() const { return m_placement; }
+
+ private:
+    // THE NEW THREAD - before it runs anything of its own
+    void Place(size_t index) {
+        name_current_thread(m_placement.name + "-" + std::to_string(index));
+        if (m_placement.cpus.empty()) {
+            return;
+        }
+
+        int cpu = m_placement.cpus[index % m_placement.cpus.size()];
+        if (!pin_current_thread(cpu)) {
+            alog::warn("[IO] ", m_placement.name, "-", index,
+                       " cannot be pinned to cpu ", cpu);
+            return;
+        }
+        // Not fatal, e.g. a container may forbid it. Memory then follows the
+        // default policy (first touch), which is still mostly local.
+        if (m_placement.local_memory && !prefer_local_node()) {
+            alog::debug("[IO] ", m_placement.name, "-", index,
+                        " keeps the default memory policy");
+        }
+    }
+
+    placement m_placement;
+    std::vector<std::thread> m_vecThreads;
+};
+
+}  // namespace iothreads
@@ -0,0 +1,200 @@
+/**
+ * @file line_reader.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 구분자로 끝나는 줄 단위 프로토콜의 수신 버퍼 (SIMD 구분자 검색)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+//* asio::async_read_until + std::getline 대신 쓴다. read_until은 읽을 때마다
+//* streambuf 전체를 처음부터 다시 훑고, getline은 istream을 거쳐 줄을 한번 더
+//* 복사한다. line_reader는
+//*   - 구분자를 SSE2/AVX2로 16/32 바이트씩 찾고,
+//*   - 이전 검색이 멈춘 위치를 기억해서 새로 들어온 바이트만 훑고,
+//*   - 줄을 수신 버퍼 위의 std::string_view로 (구분자 제외) 넘긴다.
+//* 넘겨 받은 view는 다음 async_read_line 또는 reset 호출 전까지만 유효하다.
+//* try_get_line은 버퍼를 옮기지 않으므로, 한번 읽은 데이터에 든 줄들
+//* (pipelining)을 모두 꺼내서 함께 들고 있어도 된다.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <asio.hpp>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define LINEIO_HAS_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace lineio {
+
+namespace detail {
+
+inline unsigned lowest_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+}  // namespace detail
+
+// First c in [p, p + n), or nullptr
+inline const char* find_byte(const char* p, size_t n, char c) {
+#if defined(__AVX2__)
+    const __m256i needle32 = _mm256_set1_epi8(c);
+    for (; n >= 32; p += 32, n -= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto mask     = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle32)));
+        if (mask != 0) {
+            return p + detail::lowest_bit(mask);
+        }
+    }
+#endif
+#if defined(LINEIO_HAS_SSE2)
+    const __m128i needle16 = _mm_set1_epi8(c);
+    for (; n >= 16; p += 16, n -= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto mask     = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle16)));
+        if (mask != 0) {
+            return p + detail::lowest_bit(mask);
+        }
+    }
+#endif
+    for (; n > 0; p++, n--) {
+        if (*p == c) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+//* 소켓 하나의 수신 버퍼. [m_nBegin, m_nEnd)가 아직 넘기지 않은 데이터이고
+//* [m_nBegin, m_nScanned)에는 구분자가 없다는 것을 이미 확인했다. 버퍼는
+//* 필요할 때만 (다음 읽기 직전에) 앞으로 당기고, max_line까지 늘린다.
+template <typename AsyncReadStream>
+class line_reader {
+ public:
+    static constexpr size_t MIN_BUFFER = 4096;
+
+    explicit line_reader(AsyncReadStream& stream, size_t max_line = 64 << 10,
+                         char delim = '\n')
+        : m_stream(stream), m_nMaxLine(max_line), m_delim(delim) {}
+
+    // The next complete line that is already buffered, without reading
+    std::optional<std::string_view> try_get_line() {
+        const char* base = m_buffer.data();
+        const char* hit  = find_byte(base + m_nScanned, m_nEnd - m_nScanned,
+                                     m_delim);
+        if (!hit) {
+            m_nScanned = m_nEnd;
+            return std::nullopt;
+        }
+        size_t nEnd = static_cast<size_t>(hit - base);
+        std::string_view line(base + m_nBegin, nEnd - m_nBegin);
+        m_nBegin   = nEnd + 1;
+        m_nScanned = m_nBegin;
+        return line;
+    }
+
+    // Calls handler(const asio::error_code&, std::string_view line) once a
+    // line is complete. A line longer than max_line fails with not_found,
+    // like read_until. The handler runs on its associated executor (or the
+    // stream's) and never inside this call.
+    template <typename Handler>
+    void async_read_line(Handler&& handler) {
+        auto ex = asio::get_associated_executor(handler,
+                                                m_stream.get_executor());
+        if (auto line = try_get_line()) {
+            asio::post(ex, [handler = std::forward<Handler>(handler),
+                            line = *line]() mutable {
+                handler(asio::error_code(), line);
+            });
+            return;
+        }
+
+        Compact();
+        if (m_nEnd >= m_nMaxLine) {
+            asio::post(ex, [handler = std::forward<Handler>(
+                                handler)]() mutable {
+                handler(asio::error_code(asio::error::not_found),
+                        std::string_view());
+            });
+            return;
+        }
+        if (m_nEnd == m_buffer.size()) {
+            m_buffer.resize(std::min(
+                m_nMaxLine, std::max(MIN_BUFFER, 2 * m_buffer.size())));
+        }
+
+        m_stream.async_read_some(
+            asio::buffer(m_buffer.data() + m_nEnd, m_buffer.size() - m_nEnd),
+            asio::bind_executor(
+                ex, [this, handler = std::forward<Handler>(handler)](
+                        const asio::error_code& ec, size_t n) mutable {
+                    if (ec) {
+                        handler(ec, std::string_view());
+                        return;
+                    }
+                    m_nEnd += n;
+                    if (auto line = try_get_line()) {
+                        handler(asio::error_code(), *line);
+                    } else {
+                        async_read_line(std::move(handler));
+                    }
+                }));
+    }
+
+    // Bytes received but not yet handed out as a line
+    size_t buffered() const { return m_nEnd - m_nBegin; }
+
+    // Forget everything buffered, the memory is kept for the next connection
+    void reset() {
+        m_nBegin   = 0;
+        m_nEnd     = 0;
+        m_nScanned = 0;
+    }
+
+ private:
+    // Move the unconsumed bytes to the front of the buffer
+    void Compact() {
+        if (m_nBegin == 0) {
+            return;
+        }
+        std::memmove(m_buffer.data(), m_buffer.data() + m_nBegin,
+                     m_nEnd - m_nBegin);
+        m_nEnd -= m_nBegin;
+        m_nScanned -= m_nBegin;
+        m_nBegin = 0;
+    }
+
+    AsyncReadStream& m_stream;
+    size_t m_nMaxLine;
+    char m_delim;
+
+    std::vector<char> m_buffer;
+    size_t m_nBegin   = 0;
+    size_t m_nEnd     = 0;
+    size_t m_nScanned = 0;
+};
+
+}  // namespace lineio
@@ -0,0 +1,220 @@
+/**
+ * @file trace.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 스레드 별 ring buffer에 기록하는 tracepoint와 Chrome trace JSON 출력
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+//* ENABLE_TRACE가 정의되었을 때만 (cmake -DENABLE_TRACE=ON) 기록한다. 정의되지
+//* 않으면 모든 TRACE_ 매크로는 빈 문장이 되고 인자도 평가되지 않는다.
+//*
+//*   TRACE_SCOPE("name")            이 스코프가 끝날 때까지의 구간
+//*   TRACE_BEGIN("name", id)        비동기 구간의 시작, 같은 이름과 id의
+//*   TRACE_END("name", id)          TRACE_END에서 끝난다 (스레드가 달라도 됨)
+//*   TRACE_SINCE("name", start_ns)  start_ns (trace::now_ns())부터 지금까지
+//*   TRACE_INSTANT("name")          한 시점
+//*   TRACE_DUMP("file.json")        지금까지의 기록을 Chrome trace로 저장
+//*
+//* 이름은 문자열 리터럴이어야 한다 (포인터만 저장한다). 결과 파일은
+//* chrome://tracing 또는 https://ui.perfetto.dev 에서 연다.
+
+#if defined(ENABLE_TRACE)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace trace {
+
+inline uint64_t now_ns() {
+    static const auto s_tpEpoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - s_tpEpoch)
+            .count());
+}
+
+struct event {
+    const char* name;
+    uint64_t ts_ns;
+    // Duration for complete events, id for async ones
+    uint64_t arg;
+    char phase;  // 'X' complete, 'b'/'e' async begin/end, 'i' instant
+};
+
+//* 한 스레드의 기록. 그 스레드만 쓰고 (잠금 없음), 꽉 차면 가장 오래된 것부터
+//* 덮어쓴다. 쓰는 쪽은 항목을 채운 뒤 m_nHead를 release로 올리므로 dump는
+//* m_nHead 이전의 항목만 읽는다. dump 도중에 덮어쓰일 수 있는 가장 오래된
+//* 부분 (SAFETY_MARGIN)은 건너뛴다.
+class thread_ring {
+ public:
+    static constexpr size_t CAPACITY      = 1 << 16;
+    static constexpr size_t SAFETY_MARGIN = CAPACITY / 16;
+
+    explicit thread_ring(uint32_t tid) : m_nTid(tid), m_events(CAPACITY) {}
+
+    void push(const char* name, uint64_t ts, uint64_t arg, char phase) {
+        uint64_t head = m_nHead.load(std::memory_order_relaxed);
+        m_events[head % CAPACITY] = {name, ts, arg, phase};
+        m_nHead.store(head + 1, std::memory_order_release);
+    }
+
+    uint32_t tid() const { return m_nTid; }
+
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        uint64_t head  = m_nHead.load(std::memory_order_acquire);
+        uint64_t first = head > CAPACITY - SAFETY_MARGIN
+                             ? head - (CAPACITY - SAFETY_MARGIN)
+                             : 0;
+        for (uint64_t i = first; i < head; i++) {
+            fn(m_events[i % CAPACITY]);
+        }
+    }
+
+ private:
+    uint32_t m_nTid;
+    std::vector<event> m_events;
+    std::atomic<uint64_t> m_nHead{0};
+};
+
+// Every thread that ever traced, kept after the thread has exited so that
+// its events can still be dumped
+class registry {
+ public:
+    static registry& get() {
+        static registry s_registry;
+        return s_registry;
+    }
+
+    thread_ring& local() {
+        thread_local thread_ring* tls_ring = nullptr;
+        if (!tls_ring) {
+            std::scoped_lock lock(m_mux);
+            m_vecRings.push_back(std::make_unique<thread_ring>(
+                static_cast<uint32_t>(m_vecRings.size() + 1)));
+            tls_ring = m_vecRings.back().get();
+        }
+        return *tls_ring;
+    }
+
+    // Chrome trace event format, timestamps in microseconds
+    void dump(std::ostream& os) {
+        std::scoped_lock lock(m_mux);
+        os << "{\"traceEvents\":[";
+        bool bFirst = true;
+        for (auto& ring : m_vecRings) {
+            ring->for_each([&](const event& e) {
+                os << (bFirst ? "\n" : ",\n") << "{\"name\":\"" << e.name
+                   << "\",\"ph\":\"" << e.phase << "\",\"ts\":"
+                   << e.ts_ns / 1000 << "." << Frac(e.ts_ns)
+                   << ",\"pid\":1,\"tid\":" << ring->tid();
+                if (e.phase == 'X') {
+                    os << ",\"dur\":" << e.arg / 1000 << "." << Frac(e.arg);
+                } else if (e.phase == 'b' || e.phase == 'e') {
+                    os << ",\"cat\":\"async\",\"id\":\"0x" << std::hex << e.arg
+                       << std::dec << "\"";
+                } else if (e.phase == 'i') {
+                    os << ",\"s\":\"t\"";
+                }
+                os << "}";
+                bFirst = false;
+            });
+        }
+        os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+ private:
+    // Three digits of nanoseconds below the microsecond
+    static std::string Frac(uint64_t ns) {
+        std::string s = std::to_string(ns % 1000);
+        return std::string(3 - s.size(), '0') + s;
+    }
+
+    std::mutex m_mux;
+    std::vector<std::unique_ptr<thread_ring>> m_vecRings;
+};
+
+class scope {
+ public:
+    explicit scope(const char* name) : m_name(name), m_nStart(now_ns()) {}
+    ~scope() {
+        registry::get().local().push(m_name, m_nStart, now_ns() - m_nStart,
+                                     'X');
+    }
+
+ private:
+    const char* m_name;
+    uint64_t m_nStart;
+};
+
+inline void begin(const char* name, uint64_t id) {
+    registry::get().local().push(name, now_ns(), id, 'b');
+}
+
+inline void end(const char* name, uint64_t id) {
+    registry::get().local().push(name, now_ns(), id, 'e');
+}
+
+inline void since(const char* name, uint64_t start_ns) {
+    uint64_t now = now_ns();
+    registry::get().local().push(name, start_ns,
+                                 now > start_ns ? now - start_ns : 0, 'X');
+}
+
+inline void instant(const char* name) {
+    registry::get().local().push(name, now_ns(), 0, 'i');
+}
+
+inline bool dump(const std::string& path) {
+    std::ofstream out(path);
+    registry::get().dump(out);
+    return static_cast<bool>(out);
+}
+
+}  // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    ::trace::scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_BEGIN(name, id) \
+    ::trace::begin(name, static_cast<uint64_t>(id))
+#define TRACE_END(name, id) ::trace::end(name, static_cast<uint64_t>(id))
+#define TRACE_SINCE(name, start_ns) ::trace::since(name, start_ns)
+#define TRACE_INSTANT(name) ::trace::instant(name)
+#define TRACE_DUMP(path) ::trace::dump(path)
+
+#else
+
+#define TRACE_SCOPE(name) \
+    do {                  \
+    } while (0)
+#define TRACE_BEGIN(name, id) \
+    do {                      \
+    } while (0)
+#define TRACE_END(name, id) \
+    do {                    \
+    } while (0)
+#define TRACE_SINCE(name, start_ns) \
+    do {                            \
+    } while (0)
+#define TRACE_INSTANT(name) \
+    do {                    \
+    } while (0)
+#define TRACE_DUMP(path) \
+    do {                 \
+    } while (0)
+
+#endif  // ENABLE_TRACE
@@ -14,6 +14,8 @@
 
 #include <asio.hpp>
 
+#include "line_reader.h"
+
 //* telnet을 호출하여 테스트 가능 
 //* 별도로 ./server 실행하고 별도의 터미널에 telnet localhost 15001 실행
 namespace io     = asio;
@@ -61,12 +63,11 @@ class session : public std::enable_shared_from_this<session> {
 
  private:
     /**
-     * @brief asio 비동기 읽기 연산을 수행한다.'\n'이 들어올 때까지 읽고 스트림버퍼에 저장한다.
-     * asio 비동기 읽기 연산이 완료되면 on_read 함수를 호출한다.
+     * @brief asio 비동기 읽기 연산을 수행한다.'\n'이 들어올 때까지 읽고 수신 버퍼에 저장한다.
+     * 한 줄이 완성되면 on_read 함수를 호출한다.
      */
     void async_read() {
-        io::async_read_until(
-            socket, streambuf, "\n",
+        reader.async_read_line(
             std::bind(&session::on_read, shared_from_this(), _1, _2));
         /* [capture0 = shared_from_this()](auto&& PH1, auto&& PH2) {
                 capture0->on_read(std::forward<decltype(PH1)>(PH1),
@@ -79,14 +80,12 @@ class session : public std::enable_shared_from_this<session> {
      * 메세지를 만들고 그것을 메세지 핸들러인 on_message에 전달하고 다시 비동기 읽기 연산을 시작하여 다음 메세지를 읽는다.
      * 
      * @param error 
-     * @param bytes_transferred 
+     * @param line 수신 버퍼 위의 한 줄 ('\n' 제외)
      */
-    void on_read(error_code error, std::size_t bytes_transferred) {
+    void on_read(error_code error, std::string_view line) {
         if (!error) {
             std::stringstream message;
-            message << socket.remote_endpoint(error) << ": "
-                    << std::istream(&streambuf).rdbuf();
-            streambuf.consume(bytes_transferred);
+            message << socket.remote_endpoint(error) << ": " << line << "\n";
             on_message(message.str());
             async_read();
         } else {
@@ -125,7 +124,8 @@ class session : public std::enable_shared_from_this<session> {
     }
 
     tcp::socket socket;       /// 클라이언트 소켓
-    io::streambuf streambuf;  /// incoming data를 수신하는 스트림 버퍼
+    lineio::line_reader<tcp::socket> reader{
+        socket};  /// incoming data를 줄 단위로 수신하는 버퍼
     std::queue<std::string> outgoing;  /// outgoing message를 저장하는 큐
     message_handler on_message;        /// 메세지 핸들러
     error_handler on_error;            /// 오류 핸들러
@@ -0,0 +1,400 @@
+/**
+ * @file load_generator.cpp
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief olc_simple_server용 open-loop 부하 생성기. 결과는 JSON으로 출력한다.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "olc_net.h"
+
+//* 사용법 (모든 옵션은 생략 가능)
+//*   olc_load_generator [--host 127.0.0.1] [--port 10000] [--connections 64]
+//*     [--threads 4] [--rate 10000] [--duration 10] [--drain 2]
+//*     [--mix ping=90,broadcast=5,custom=5] [--custom-id 100]
+//*     [--custom-size 64]
+//*
+//* --rate는 전체 연결이 보내는 초당 메세지 수다. 각 연결은 응답을 기다리지
+//* 않고 정해진 시각마다 메세지를 보낸다 (open-loop). 서버가 느려져도 보내는
+//* 속도가 줄지 않고, ping의 지연 시간은 실제로 보낸 시각이 아니라 보냈어야
+//* 하는 시각부터 잰다. 따라서 밀린 요청의 대기 시간도 결과에 포함된다
+//* (coordinated omission 방지). 실제로 보낸 시각부터 잰 값은 service_time으로
+//* 따로 보고한다.
+//*
+//* ping     : ServerPing, 서버가 그대로 돌려준다.
+//* broadcast: MessageAll, 서버가 보낸 클라이언트를 제외한 모두에게
+//*            ServerMessage를 보낸다. 수신 개수만 센다.
+//* custom   : --custom-id/--custom-size의 메세지, 응답은 기대하지 않는다.
+
+// simple_server.cpp와 같은 메세지 id
+enum class CustomMsgTypes : uint32_t {
+    ServerAccept,
+    ServerDeny,
+    ServerPing,
+    MessageAll,
+    ServerMessage,
+};
+
+using Clock      = std::chrono::steady_clock;
+using Message    = olc::net::message<CustomMsgTypes>;
+using Connection = olc::net::connection<CustomMsgTypes>;
+
+enum FrameKind { PING, BROADCAST, CUSTOM, FRAME_KINDS };
+const char* FRAME_NAMES[FRAME_KINDS] = {"ping", "broadcast", "custom"};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "10000";
+    int connections  = 64;
+    int threads      = 4;
+    double rate      = 10000.0;
+    double duration  = 10.0;
+    double drain     = 2.0;
+    double mix[FRAME_KINDS] = {90.0, 5.0, 5.0};
+    uint32_t customId       = 100;
+    size_t customSize       = 64;
+};
+
+// Results of one io thread, only touched by that thread until it is joined
+struct ThreadStats {
+    uint64_t sent[FRAME_KINDS] = {};
+    uint64_t pingReplies       = 0;
+    uint64_t broadcastsIn      = 0;
+    uint64_t errors            = 0;
+    std::vector<double> latencyUs;
+    std::vector<double> serviceUs;
+};
+
+//* 연결 하나의 송신 스케줄. 다음 메세지를 보낼 시각 (m_tNext)은 이전 메세지를
+//* 보낸 시각과 관계 없이 간격만큼씩 늘어난다. 타이머가 늦게 깨어나면 밀린
+//* 메세지를 한번에 보낸다.
+class Session : public std::enable_shared_from_this<Session> {
+ public:
+    Session(asio::io_context& ioc, const Options& opt, ThreadStats& stats,
+            olc::net::tsqueue<olc::net::owned_message<CustomMsgTypes>>& qIn,
+            Clock::duration interval, uint32_t seed)
+        : m_opt(opt),
+          m_stats(stats),
+          m_interval(interval),
+          m_timer(ioc),
+          m_rng(seed),
+          m_mix(std::begin(opt.mix), std::end(opt.mix)) {
+        m_connection = std::make_shared<Connection>(
+            Connection::owner::client, ioc, asio::ip::tcp::socket(ioc), qIn);
+
+        // Every reply is handled right here on the io thread, nothing is
+        // queued
+        m_connection->SetIncomingFilter([this](Message& msg) {
+            OnReply(msg);
+            return true;
+        });
+        m_connection->SetDisconnectHandler([this]() { m_stats.errors++; });
+    }
+
+    void Start(const asio::ip::tcp::resolver::results_type& endpoints,
+               Clock::time_point tStart, Clock::time_point tEnd) {
+        m_tEnd = tEnd;
+        // Spread the connections over one interval so they do not send in
+        // lock step
+        std::uniform_int_distribution<Clock::rep> phase(
+            0, std::max<Clock::rep>(0, m_interval.count() - 1));
+        m_tNext = tStart + Clock::duration(phase(m_rng));
+
+        m_connection->ConnectToServer(endpoints,
+                                      [self = shared_from_this()]() {
+                                          self->ScheduleNext();
+                                      });
+    }
+
+    void Stop() { m_connection->Disconnect(); }
+
+ private:
+    void ScheduleNext() {
+        if (m_tNext >= m_tEnd || !m_connection->IsConnected()) {
+            return;
+        }
+        m_timer.expires_at(m_tNext);
+        m_timer.async_wait(
+            [self = shared_from_this()](const asio::error_code& ec) {
+                if (!ec) {
+                    self->SendDue();
+                }
+            });
+    }
+
+    void SendDue() {
+        auto now = Clock::now();
+        while (m_tNext <= now && m_tNext < m_tEnd) {
+            SendFrame(m_tNext, now);
+            m_tNext += m_interval;
+        }
+        ScheduleNext();
+    }
+
+    void SendFrame(Clock::time_point tIntended, Clock::time_point tActual) {
+        auto kind = static_cast<FrameKind>(m_mix(m_rng));
+        Message msg;
+        switch (kind) {
+            case PING:
+                msg.header.id = CustomMsgTypes::ServerPing;
+                msg << tIntended.time_since_epoch().count()
+                    << tActual.time_since_epoch().count();
+                break;
+            case BROADCAST:
+                msg.header.id = CustomMsgTypes::MessageAll;
+                break;
+            default:
+                msg.header.id = static_cast<CustomMsgTypes>(m_opt.customId);
+                msg.body.resize(m_opt.customSize);
+                msg.header.size = msg.size();
+                break;
+        }
+        m_connection->Send(msg);
+        m_stats.sent[kind]++;
+    }
+
+    // IO THREAD
+    void OnReply(Message& msg) {
+        switch (msg.header.id) {
+            case CustomMsgTypes::ServerPing: {
+                auto now = Clock::now();
+                Clock::rep intended, actual;
+                msg >> actual >> intended;
+                std::chrono::duration<double, std::micro> latency =
+                    now - Clock::time_point(Clock::duration(intended));
+                std::chrono::duration<double, std::micro> service =
+                    now - Clock::time_point(Clock::duration(actual));
+                m_stats.latencyUs.push_back(latency.count());
+                m_stats.serviceUs.push_back(service.count());
+                m_stats.pingReplies++;
+            } break;
+            case CustomMsgTypes::ServerMessage:
+                m_stats.broadcastsIn++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    const Options& m_opt;
+    ThreadStats& m_stats;
+    Clock::duration m_interval;
+    Clock::time_point m_tNext;
+    Clock::time_point m_tEnd;
+    asio::steady_timer m_timer;
+    std::mt19937 m_rng;
+    std::discrete_distribution<int> m_mix;
+    std::shared_ptr<Connection> m_connection;
+};
+
+double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t idx = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+void PrintLatency(const char* name, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double v : samples) {
+        sum += v;
+    }
+    std::cout << "  \"" << name << "\": {"
+              << "\"count\": " << samples.size() << ", \"mean\": "
+              << (samples.empty() ? 0.0 : sum / samples.size())
+              << ", \"p50\": " << Percentile(samples, 50)
+              << ", \"p90\": " << Percentile(samples, 90)
+              << ", \"p99\": " << Percentile(samples, 99)
+              << ", \"p99.9\": " << Percentile(samples, 99.9)
+              << ", \"max\": " << (samples.empty() ? 0.0 : samples.back())
+              << "}";
+}
+
+bool ParseMix(const std::string& spec, Options& opt) {
+    std::fill(std::begin(opt.mix), std::end(opt.mix), 0.0);
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(pos, end - pos);
+        size_t eq        = item.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, eq);
+        auto it = std::find_if(std::begin(FRAME_NAMES), std::end(FRAME_NAMES),
+                               [&name](const char* n) { return name == n; });
+        if (it == std::end(FRAME_NAMES)) {
+            return false;
+        }
+        opt.mix[it - std::begin(FRAME_NAMES)] = std::atof(item.c_str() + eq + 1);
+        pos = end + 1;
+    }
+    return std::any_of(std::begin(opt.mix), std::end(opt.mix),
+                       [](double w) { return w > 0.0; });
+}
+
+bool ParseArgs(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        const char* val = argv[i + 1];
+        if (key == "--host") {
+            opt.host = val;
+        } else if (key == "--port") {
+            opt.port = val;
+        } else if (key == "--connections") {
+            opt.connections = std::max(1, std::atoi(val));
+        } else if (key == "--threads") {
+            opt.threads = std::max(1, std::atoi(val));
+        } else if (key == "--rate") {
+            opt.rate = std::atof(val);
+        } else if (key == "--duration") {
+            opt.duration = std::atof(val);
+        } else if (key == "--drain") {
+            opt.drain = std::atof(val);
+        } else if (key == "--mix") {
+            if (!ParseMix(val, opt)) {
+                return false;
+            }
+        } else if (key == "--custom-id") {
+            opt.customId = static_cast<uint32_t>(std::atoi(val));
+        } else if (key == "--custom-size") {
+            opt.customSize = static_cast<size_t>(std::atoi(val));
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.rate > 0.0 && std::isfinite(opt.rate);
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--host h] [--port p] [--connections n] [--threads n]"
+                     " [--rate msg/s] [--duration s] [--drain s]"
+                     " [--mix ping=90,broadcast=5,custom=5]"
+                     " [--custom-id id] [--custom-size bytes]\n";
+        return 1;
+    }
+
+    // stdout is for the JSON report only
+    alog::set_stderr_level(alog::level::debug);
+
+    // One io context per thread, connections are spread over them. Every
+    // thread has its own stats, so the measuring path takes no lock.
+    std::vector<std::unique_ptr<asio::io_context>> contexts;
+    std::vector<ThreadStats> stats(opt.threads);
+    for (int i = 0; i < opt.threads; i++) {
+        contexts.push_back(std::make_unique<asio::io_context>());
+    }
+
+    // Replies are consumed by the filter, so this queue stays empty
+    olc::net::tsqueue<olc::net::owned_message<CustomMsgTypes>> qUnused;
+
+    std::vector<std::shared_ptr<Session>> sessions;
+    try {
+        asio::ip::tcp::resolver resolver(*contexts[0]);
+        auto endpoints = resolver.resolve(opt.host, opt.port);
+
+        // At least one tick, or SendDue would never get past a frame
+        auto interval = std::max(
+            Clock::duration(1),
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(opt.connections / opt.rate)));
+        // Give every connection time to be made before the schedule starts
+        auto tStart = Clock::now() + std::chrono::milliseconds(500);
+        auto tEnd   = tStart + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(opt.duration));
+
+        for (int i = 0; i < opt.connections; i++) {
+            int t = i % opt.threads;
+            sessions.push_back(std::make_shared<Session>(
+                *contexts[t], opt, stats[t], qUnused, interval, i + 1));
+            sessions.back()->Start(endpoints, tStart, tEnd);
+        }
+
+        std::vector<std::thread> threads;
+        for (auto& context : contexts) {
+            threads.emplace_back([&context]() {
+                auto work = asio::make_work_guard(context->get_executor());
+                context->run();
+            });
+        }
+
+        // Let the replies of the last requests come back, then close down
+        std::this_thread::sleep_until(
+            tEnd + std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double>(opt.drain)));
+        for (auto& session : sessions) {
+            session->Stop();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (auto& context : contexts) {
+            context->stop();
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    } catch (std::exception& e) {
+        std::cerr << "[LOAD] Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    // Merge the per thread results
+    ThreadStats total;
+    for (auto& s : stats) {
+        for (int k = 0; k < FRAME_KINDS; k++) {
+            total.sent[k] += s.sent[k];
+        }
+        total.pingReplies += s.pingReplies;
+        total.broadcastsIn += s.broadcastsIn;
+        total.errors += s.errors;
+        total.latencyUs.insert(total.latencyUs.end(), s.latencyUs.begin(),
+                               s.latencyUs.end());
+        total.serviceUs.insert(total.serviceUs.end(), s.serviceUs.begin(),
+                               s.serviceUs.end());
+    }
+    uint64_t nSent = 0;
+    for (int k = 0; k < FRAME_KINDS; k++) {
+        nSent += total.sent[k];
+    }
+
+    std::cout << "{\n"
+              << "  \"connections\": " << opt.connections
+              << ",\n  \"threads\": " << opt.threads
+              << ",\n  \"target_rate\": " << opt.rate
+              << ",\n  \"duration_s\": " << opt.duration
+              << ",\n  \"sent\": {\"ping\": " << total.sent[PING]
+              << ", \"broadcast\": " << total.sent[BROADCAST]
+              << ", \"custom\": " << total.sent[CUSTOM] << "}"
+              << ",\n  \"achieved_rate\": " << nSent / opt.duration
+              << ",\n  \"ping_replies\": " << total.pingReplies
+              << ",\n  \"ping_lost\": " << total.sent[PING] - total.pingReplies
+              << ",\n  \"broadcasts_received\": " << total.broadcastsIn
+              << ",\n  \"reply_throughput\": "
+              << total.pingReplies / opt.duration
+              << ",\n  \"errors\": " << total.errors << ",\n";
+    std::cout << "  \"latency_unit\": \"us\",\n";
+    PrintLatency("latency", total.latencyUs);
+    std::cout << ",\n";
+    PrintLatency("service_time", total.serviceUs);
+    std::cout << "\n}\n";
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * @file net_capture.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 서버로 들어오는 메세지 스트림의 기록 (memory-mapped log)과 재생용 읽기
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OLC_NET_HAS_CAPTURE 1
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "net_message.h"
+
+namespace olc::net {
+
+//* 파일 = [capture_file_header][record]...
+//* record = [capture_record_header][body]
+//* 시간은 기록을 시작한 시점부터의 ns (steady clock)이다. 레코드는 스레드
+//* 별로 묶여서 쓰이므로 파일 안에서 시간 순서대로 있지는 않다.
+struct capture_file_header {
+    static constexpr char MAGIC[8] = {'O', 'L', 'C', 'C', 'A', 'P', '1', 0};
+
+    char magic[8];
+    // Wall clock at the start of the capture, ns since the unix epoch
+    uint64_t start_unix_ns;
+    // Bytes of records that follow, updated after every batch so that the log
+    // of a crashed process is readable up to its last batch
+    std::atomic<uint64_t> data_bytes;
+    uint8_t reserved[40];
+};
+static_assert(sizeof(capture_file_header) == 64);
+
+struct capture_record_header {
+    uint64_t time_ns;
+    uint32_t client_id;
+    uint32_t msg_id;
+    uint32_t correlation_id;
+    uint32_t size;
+};
+
+//* 기록하는 스레드 (connection의 io 스레드)는 자신의 버퍼에 잠금 없이
+//* 레코드를 붙이고, 버퍼가 BATCH_BYTES를 넘거나 FLUSH_INTERVAL이 지나면 한번에
+//* 로그로 옮긴다. 로그 쪽 잠금은 이 batch 단위로만 잡는다. 더 기록하지 않는
+//* 스레드의 버퍼는 소유자 (서버)가 FLUSH_INTERVAL마다 flush()로 옮긴다.
+//* 버퍼마다 있는 잠금은 이때만 경합한다. 파일은 GROW_BYTES씩 늘리며 통째로
+//* mmap하고, 닫을 때 실제 길이로 자른다.
+class capture_writer {
+ public:
+    static constexpr size_t BATCH_BYTES = 64 << 10;
+    static constexpr size_t GROW_BYTES  = 64 << 20;
+    static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(100);
+
+    capture_writer() = default;
+    capture_writer(const capture_writer&) = delete;
+    ~capture_writer() { close(); }
+
+    // Truncates an existing file
+    bool open(const std::string& path) {
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0 || !Grow(sizeof(capture_file_header))) {
+            close();
+            return false;
+        }
+
+        auto* header = new (m_pBase) capture_file_header{};
+        std::memcpy(header->magic, capture_file_header::MAGIC,
+                    sizeof(header->magic));
+        header->start_unix_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        m_nWritten = sizeof(capture_file_header);
+        m_tpStart  = std::chrono::steady_clock::now();
+        m_nSerial  = s_nNextSerial.fetch_add(1);
+        return true;
+    }
+
+    // Flushes every thread's buffer, so nobody may record any more
+    void close() {
+        if (m_fd < 0) {
+            return;
+        }
+        {
+            std::scoped_lock lock(m_muxBuffers, m_muxLog);
+            for (auto& buffer : m_vecBuffers) {
+                Commit(*buffer);
+            }
+            m_vecBuffers.clear();
+        }
+        if (m_pBase) {
+            ::munmap(m_pBase, m_nMapped);
+            m_pBase = nullptr;
+        }
+        if (::ftruncate(m_fd, static_cast<off_t>(m_nWritten)) != 0) {
+            // Only leaves zeroed space at the end, data_bytes still holds
+        }
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    bool is_open() const { return m_fd >= 0; }
+
+    // Commit every thread's buffer, so that records of a thread that has gone
+    // quiet reach the log as well. Safe to call while others record.
+    void flush() {
+        auto now = std::chrono::steady_clock::now();
+        std::scoped_lock lock(m_muxBuffers);
+        for (auto& buffer : m_vecBuffers) {
+            std::scoped_lock bufferLock(buffer->mux, m_muxLog);
+            Commit(*buffer);
+            buffer->tpLastFlush = now;
+        }
+    }
+
+    void record(uint32_t nClientID, uint32_t nMsgID, uint32_t nCorrelationID,
+                const uint8_t* body, size_t nSize) {
+        auto now = std::chrono::steady_clock::now();
+        capture_record_header rec;
+        rec.time_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                                 m_tpStart)
+                .count());
+        rec.client_id      = nClientID;
+        rec.msg_id         = nMsgID;
+        rec.correlation_id = nCorrelationID;
+        rec.size           = static_cast<uint32_t>(nSize);
+
+        thread_buffer& buffer = LocalBuffer();
+        std::scoped_lock bufferLock(buffer.mux);
+        size_t n = buffer.bytes.size();
+        buffer.bytes.resize(n + sizeof(rec) + nSize);
+        std::memcpy(buffer.bytes.data() + n, &rec, sizeof(rec));
+        if (nSize > 0) {
+            std::memcpy(buffer.bytes.data() + n + sizeof(rec), body, nSize);
+        }
+
+        if (buffer.bytes.size() >= BATCH_BYTES ||
+            now - buffer.tpLastFlush >= FLUSH_INTERVAL) {
+            std::scoped_lock lock(m_muxLog);
+            Commit(buffer);
+            buffer.tpLastFlush = now;
+        }
+    }
+
+    template <typename T>
+    void record(uint32_t nClientID, const message<T>& msg) {
+        record(nClientID, static_cast<uint32_t>(msg.header.id),
+               msg.header.correlation_id, msg.body.data(), msg.body.size());
+    }
+
+ private:
+    struct thread_buffer {
+        // Only contended by flush()
+        std::mutex mux;
+        std::vector<uint8_t> bytes;
+        std::chrono::steady_clock::time_point tpLastFlush;
+    };
+
+    // The buffer of the calling thread, registered on its first record. Only
+    // the most recent writer is cached per thread.
+    thread_buffer& LocalBuffer() {
+        thread_local uint64_t tls_serial       = 0;
+        thread_local thread_buffer* tls_buffer = nullptr;
+        if (tls_serial != m_nSerial) {
+            std::scoped_lock lock(m_muxBuffers);
+            m_vecBuffers.push_back(std::make_unique<thread_buffer>());
+            m_vecBuffers.back()->bytes.reserve(BATCH_BYTES * 2);
+            m_vecBuffers.back()->tpLastFlush = std::chrono::steady_clock::now();
+            tls_buffer = m_vecBuffers.back().get();
+            tls_serial = m_nSerial;
+        }
+        return *tls_buffer;
+    }
+
+    // Append the buffer to the log and empty it, the log lock must be held
+    // (or nobody else is writing any more)
+    void Commit(thread_buffer& buffer) {
+        if (buffer.bytes.empty()) {
+            return;
+        }
+        if (m_nWritten + buffer.bytes.size() > m_nMapped &&
+            !Grow(m_nWritten + buffer.bytes.size())) {
+            buffer.bytes.clear();
+            return;
+        }
+        std::memcpy(static_cast<uint8_t*>(m_pBase) + m_nWritten,
+                    buffer.bytes.data(), buffer.bytes.size());
+        m_nWritten += buffer.bytes.size();
+        static_cast<capture_file_header*>(m_pBase)->data_bytes.store(
+            m_nWritten - sizeof(capture_file_header),
+            std::memory_order_release);
+        buffer.bytes.clear();
+    }
+
+    // Extend the file (in GROW_BYTES steps) and map all of it again
+    bool Grow(size_t nNeeded) {
+        size_t nSize = m_nMapped;
+        while (nSize < nNeeded) {
+            nSize += GROW_BYTES;
+        }
+        if (::ftruncate(m_fd, static_cast<off_t>(nSize)) != 0) {
+            return false;
+        }
+        if (m_pBase) {
+            ::munmap(m_pBase, m_nMapped);
+        }
+        void* p = ::mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         m_fd, 0);
+        if (p == MAP_FAILED) {
+            m_pBase   = nullptr;
+            m_nMapped = 0;
+            return false;
+        }
+        m_pBase   = p;
+        m_nMapped = nSize;
+        return true;
+    }
+
+    static inline std::atomic<uint64_t> s_nNextSerial{1};
+
+    int m_fd          = -1;
+    void* m_pBase     = nullptr;
+    size_t m_nMapped  = 0;
+    size_t m_nWritten = 0;
+    std::chrono::steady_clock::time_point m_tpStart;
+    uint64_t m_nSerial = 0;
+
+    std::mutex m_muxLog;
+    std::mutex m_muxBuffers;
+    std::vector<std::unique_ptr<thread_buffer>> m_vecBuffers;
+};
+
+struct capture_record {
+    uint64_t time_ns        = 0;
+    uint32_t client_id      = 0;
+    uint32_t msg_id         = 0;
+    uint32_t correlation_id = 0;
+    std::vector<uint8_t> body;
+
+    template <typename T>
+    message<T> to_message() const {
+        message<T> msg;
+        msg.header.id             = static_cast<T>(msg_id);
+        msg.header.correlation_id = correlation_id;
+        msg.body                  = body;
+        msg.header.size           = static_cast<uint32_t>(body.size());
+        return msg;
+    }
+};
+
+// Reads the records of a capture, in file order
+class capture_reader {
+ public:
+    bool open(const std::string& path) {
+        m_file.open(path, std::ios::binary);
+        if (!m_file.read(m_header, sizeof(m_header)) ||
+            std::memcmp(m_header, capture_file_header::MAGIC,
+                        sizeof(capture_file_header::MAGIC)) != 0) {
+            return false;
+        }
+        std::memcpy(&m_nStartUnixNs, m_header + 8, sizeof(m_nStartUnixNs));
+        std::memcpy(&m_nRemaining, m_header + 16, sizeof(m_nRemaining));
+        return true;
+    }
+
+    uint64_t start_unix_ns() const { return m_nStartUnixNs; }
+
+    bool next(capture_record& out) {
+        capture_record_header rec;
+        if (m_nRemaining < sizeof(rec) ||
+            !m_file.read(reinterpret_cast<char*>(&rec), sizeof(rec)) ||
+            m_nRemaining - sizeof(rec) < rec.size) {
+            return false;
+        }
+        out.time_ns        = rec.time_ns;
+        out.client_id      = rec.client_id;
+        out.msg_id         = rec.msg_id;
+        out.correlation_id = rec.correlation_id;
+        out.body.resize(rec.size);
+        if (!m_file.read(reinterpret_cast<char*>(out.body.data()), rec.size)) {
+            return false;
+        }
+        m_nRemaining -= sizeof(rec) + rec.size;
+        return true;
+    }
+
+ private:
+    std::ifstream m_file;
+    char m_header[sizeof(capture_file_header)];
+    uint64_t m_nStartUnixNs = 0;
+    uint64_t m_nRemaining   = 0;
+};
+
+}  // namespace olc::net
+
+#endif  // __unix__ || __APPLE__
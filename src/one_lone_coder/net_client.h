@@ -9,47 +9,104 @@
  *
  */
 #pragma once
+#include <array>
+#include <cmath>
 #include <memory>
+#include <optional>
+#include <random>
+#include <vector>
 
 #include <asio.hpp>
 
 #include "net_common.h"
 #include "net_connection.h"
 #include "net_message.h"
+#include "net_socket_options.h"
 #include "net_tsqueue.h"
+#include "net_udp_channel.h"
 
 namespace olc::net {
 
-template <typename T>
+// Auto reconnect settings of client_interface. Every failed attempt multiplies
+// the backoff delay, and the actual wait is jittered between half and all of
+// it so that many clients losing the same server do not come back in lockstep.
+struct reconnect_policy {
+    std::chrono::milliseconds initial_delay{100};
+    std::chrono::milliseconds max_delay{10000};
+    double multiplier = 2.0;
+
+    // Messages sent while disconnected are kept (in order) up to this many and
+    // replayed once connected again. Further sends are rejected.
+    size_t max_pending_messages = 1024;
+};
+
+//* Protocol은 connection과 같은 stream protocol이다. TCP는 호스트 이름과 포트로,
+//* 그 외 (예: asio::local::stream_protocol)는 endpoint로 접속한다.
+template <typename T, typename Protocol = asio::ip::tcp>
 class client_interface {
  public:
+    using connection_type    = connection<T, Protocol>;
+    using owned_message_type = typename connection_type::owned_message_type;
+
     client_interface() = default;
 
+    // The socket options policy is applied once the connection is made
+    explicit client_interface(const socket_options& options)
+        : m_socketOptions(options) {}
+
     virtual ~client_interface() {
         // If the client is destroyed, always try and disconnect from server
         Disconnect();
     }
 
-    // Connect to server with hostname/ip-address and port
+    // Keep reconnecting to the same server when the connection is lost.
+    // Must be called before Connect().
+    void EnableAutoReconnect(const reconnect_policy& policy = {}) {
+        m_reconnect = policy;
+    }
+
+    // Negotiate a UDP side channel with the server (which must have enabled
+    // it too) every time the TCP connection is made. See SendUnreliable().
+    // Must be called before Connect().
+    void EnableUnreliableChannel(size_t nMtu = 1200) {
+        static_assert(std::is_same_v<Protocol, asio::ip::tcp>,
+                      "The UDP side channel needs a TCP client");
+        m_nUdpMtu = nMtu;
+    }
+
+    // Connect to server with hostname/ip-address and port (TCP)
     bool Connect(const std::string& host, const uint16_t port) {
         try {
-            // Resolve hostname/ip-address into tangiable physical address
+            // Resolve hostname/ip-address into tangiable physical address.
+            //* 재접속할 때는 다시 resolve하지 않고 이 결과를 사용한다.
             asio::ip::tcp::resolver resolver(m_context);
-            asio::ip::tcp::resolver::results_type endpoints =
-                resolver.resolve(host, std::to_string(port));
+            auto results = resolver.resolve(host, std::to_string(port));
+            return Connect(std::vector<typename Protocol::endpoint>(
+                results.begin(), results.end()));
+        } catch (std::exception& e) {
+            alog::error("Client Exception: ", e.what());
+            return false;
+        }
+    }
 
-            // Create connection
-            m_connection = std::make_unique<connection<T>>(
-                connection<T>::owner::client, m_context,
-                asio::ip::tcp::socket(m_context), m_qMessagesIn);
+    // Connect to a server endpoint of any protocol, e.g. the socket file path
+    // of a asio::local::stream_protocol::endpoint
+    bool Connect(const typename Protocol::endpoint& endpoint) {
+        return Connect(std::vector<typename Protocol::endpoint>{endpoint});
+    }
+
+    // Connect to the first endpoint of the list that accepts
+    bool Connect(std::vector<typename Protocol::endpoint> endpoints) {
+        try {
+            m_endpoints = std::move(endpoints);
 
-            // Tell the connection object to connect to server
-            m_connection->ConnectToServer(endpoints);
+            // Create connection and tell it to connect to server
+            StartConnection();
 
             // Start Context Thread
             thrContext = std::thread([this]() { m_context.run(); });
         } catch (std::exception& e) {
-            std::cerr << "Client Exception: " << e.what() << "\n";
+            alog::error("Client Exception: ", e.what());
             return false;
         }
         return true;
@@ -57,10 +114,16 @@ class client_interface {
 
     // Disconnect from server
     void Disconnect() {
-        // If connection exists, and it's connected then...
-        if (IsConnected()) {
-            // ...disconnect from server gracefully
-            m_connection->Disconnect();
+        {
+            std::scoped_lock lock(m_muxConnection);
+            // No more reconnecting from here on
+            m_bStopping = true;
+
+            // If connection exists, and it's connected then...
+            if (m_connection && m_connection->IsConnected()) {
+                // ...disconnect from server gracefully
+                m_connection->Disconnect();
+            }
         }
 
         // Either way, we're also done with the asio context...
@@ -71,26 +134,57 @@ class client_interface {
         }
 
         // Destroy the connection object
-        m_connection.release();
+        m_connection.reset();
     }
 
     // Check if client is actually connected to a server
     bool IsConnected() {
+        std::scoped_lock lock(m_muxConnection);
         if (m_connection) {
             return m_connection->IsConnected();
         }
         return false;
     }
 
-    // Send message to server
-    void Send(const message<T>& msg) {
-        if (IsConnected()) {
+    // Send message to server. With auto reconnect, a message sent while
+    // disconnected is buffered and false is only returned if the buffer is
+    // full. True only means the message was handed to the connection: if the
+    // connection has died but that is not detected yet, the message is lost
+    // (it is not replayed after reconnecting).
+    bool Send(const message<T>& msg) {
+        std::scoped_lock lock(m_muxConnection);
+        if (!m_reconnect) {
+            if (m_connection && m_connection->IsConnected()) {
+                m_connection->Send(msg);
+                return true;
+            }
+            return false;
+        }
+
+        if (m_bConnected) {
             m_connection->Send(msg);
+            return true;
+        }
+        if (m_deqPending.size() < m_reconnect->max_pending_messages) {
+            m_deqPending.push_back(msg);
+            return true;
+        }
+        return false;
+    }
+
+    // Send a message over the UDP side channel, see
+    // connection::SendUnreliable(). Not buffered while disconnected.
+    bool SendUnreliable(const message<T>& msg) {
+        std::scoped_lock lock(m_muxConnection);
+        if (m_connection && m_connection->IsConnected()) {
+            m_connection->SendUnreliable(msg);
+            return true;
         }
+        return false;
     }
 
     // Retrieve queue of messages from server
-    tsqueue<owned_message<T>>& Incoming() { return m_qMessagesIn; }
+    tsqueue<owned_message_type>& Incoming() { return m_qMessagesIn; }
 
  protected:
     // asio context handles the data transfer...
@@ -102,10 +196,203 @@ class client_interface {
     // data transfer
     // client가 io_context, socket등의 정보로 connection을 생성한다.
     // 즉, 해당 정보는 client가 소유권을 가지고 있다.
-    std::unique_ptr<connection<T>> m_connection;
+    //* 재접속하면 asio 스레드에서 새 connection으로 교체되므로 m_muxConnection
+    //* 으로 보호한다.
+    std::shared_ptr<connection_type> m_connection;
+
+    // Socket options applied to the connected socket
+    socket_options m_socketOptions;
+
+    // ASIO THREAD - Called for every message from the server before it is
+    // queued in Incoming(). Return true if the message has been handled here
+    // and should not be queued.
+    virtual bool OnMessageReceived([[maybe_unused]] message<T>& msg) {
+        return false;
+    }
 
  private:
+    // Create a fresh connection and start connecting to the cached endpoints
+    void StartConnection() {
+        auto conn = std::make_shared<connection_type>(
+            connection_type::owner::client, m_context,
+            typename Protocol::socket(m_context), m_qMessagesIn);
+        conn->SetSocketOptions(m_socketOptions);
+        conn->SetDisconnectHandler([this]() { OnConnectionLost(); });
+        conn->SetIncomingFilter([this](message<T>& msg) {
+            if (msg.header.correlation_id == UDP_TOKEN_CORRELATION_ID) {
+                OnUdpToken(msg);
+                return true;
+            }
+            return OnMessageReceived(msg);
+        });
+
+        // The previous connection (if any) is kept alive by its own pending
+        // handlers until they have run, so it can be let go right away
+        {
+            std::scoped_lock lock(m_muxConnection);
+            m_connection = conn;
+        }
+        conn->ConnectToServer(m_endpoints, [this]() { OnConnected(); });
+    }
+
+    // ASIO THREAD - connected, replay everything sent in the meantime in order
+    void OnConnected() {
+        std::scoped_lock lock(m_muxConnection);
+        m_bConnected        = true;
+        m_nReconnectAttempt = 0;
+        while (!m_deqPending.empty()) {
+            m_connection->Send(m_deqPending.front());
+            m_deqPending.pop_front();
+        }
+    }
+
+    // ASIO THREAD - The server hands every connection a token for the UDP
+    // side channel, if it has one
+    void OnUdpToken([[maybe_unused]] message<T>& msg) {
+        if constexpr (std::is_same_v<Protocol, asio::ip::tcp>) {
+            uint64_t nToken = 0;
+            if (m_nUdpMtu > 0 && msg.size() == sizeof(nToken)) {
+                msg >> nToken;
+                std::scoped_lock lock(m_muxConnection);
+                if (m_connection) {
+                    StartUdpChannel(nToken);
+                }
+            }
+        }
+    }
+
+    // ASIO THREAD - A fresh channel for every TCP connection, on one UDP
+    // socket for the lifetime of the client
+    void StartUdpChannel(uint64_t nToken) {
+        const auto& remote = m_connection->GetRemoteEndpoint();
+        asio::ip::udp::endpoint server(remote.address(), remote.port());
+        if (!m_udpSocket) {
+            m_udpSocket.emplace(m_context,
+                                asio::ip::udp::endpoint(server.protocol(), 0));
+            ReadDatagram();
+        }
+        m_udpChannel = std::make_shared<udp_channel<T>>(*m_udpSocket, server,
+                                                        m_nUdpMtu, nToken);
+        m_nUdpHelloAttempts = 0;
+        SendUdpHello();
+    }
+
+    // ASIO THREAD - The server finds our TCP connection by the token. Repeated
+    // until the welcome comes back, as either datagram may be lost.
+    void SendUdpHello() {
+        m_udpChannel->send_control(udp_packet_header::hello);
+        if (++m_nUdpHelloAttempts >= 10) {
+            return;
+        }
+        m_timerUdpHello.expires_after(std::chrono::milliseconds(200));
+        m_timerUdpHello.async_wait(
+            [this, channel = m_udpChannel](std::error_code ec) {
+                if (!ec && channel == m_udpChannel) {
+                    SendUdpHello();
+                }
+            });
+    }
+
+    // ASIO THREAD
+    void ReadDatagram() {
+        m_udpSocket->async_receive_from(
+            asio::buffer(m_udpBuffer), m_udpSender,
+            [this](asio::error_code ec, std::size_t length) {
+                if (ec == asio::error::operation_aborted) {
+                    return;
+                }
+                udp_packet_header packet;
+                if (!ec && m_udpChannel &&
+                    m_udpSender == m_udpChannel->remote() &&
+                    udp_packet_header::parse(m_udpBuffer.data(), length,
+                                             packet) &&
+                    packet.token == m_udpChannel->token()) {
+                    OnDatagram(packet, length);
+                }
+                ReadDatagram();
+            });
+    }
+
+    // ASIO THREAD
+    void OnDatagram(const udp_packet_header& packet, size_t length) {
+        std::shared_ptr<connection_type> conn;
+        {
+            std::scoped_lock lock(m_muxConnection);
+            conn = m_connection;
+        }
+        if (!conn) {
+            return;
+        }
+
+        if (packet.kind == udp_packet_header::welcome) {
+            if (!conn->GetUdpChannel()) {
+                conn->SetUdpChannel(m_udpChannel);
+                m_timerUdpHello.cancel();
+            }
+        } else if (packet.kind == udp_packet_header::data &&
+                   conn->GetUdpChannel() == m_udpChannel) {
+            std::optional<message<T>> msg = m_udpChannel->receive(
+                packet, m_udpBuffer.data() + sizeof(packet),
+                length - sizeof(packet));
+            if (msg) {
+                conn->DeliverUnreliable(std::move(*msg));
+            }
+        }
+    }
+
+    // ASIO THREAD - connect failed or the connection died
+    void OnConnectionLost() {
+        std::scoped_lock lock(m_muxConnection);
+        m_bConnected = false;
+        if (!m_reconnect || m_bStopping) {
+            return;
+        }
+
+        m_timerReconnect.expires_after(NextBackoff());
+        m_timerReconnect.async_wait([this](std::error_code ec) {
+            if (!ec) {
+                StartConnection();
+            }
+        });
+    }
+
+    // Exponential backoff with "equal jitter": [delay/2, delay]
+    std::chrono::milliseconds NextBackoff() {
+        double delay = m_reconnect->initial_delay.count() *
+                       std::pow(m_reconnect->multiplier, m_nReconnectAttempt);
+        delay = std::min(delay, double(m_reconnect->max_delay.count()));
+        if (delay < double(m_reconnect->max_delay.count())) {
+            m_nReconnectAttempt++;
+        }
+
+        std::uniform_real_distribution<double> jitter(delay / 2.0, delay);
+        return std::chrono::milliseconds(
+            static_cast<std::chrono::milliseconds::rep>(jitter(m_rng)));
+    }
+
     // This is the thread safe queue of incoming messages from server
-    tsqueue<owned_message<T>> m_qMessagesIn;
+    tsqueue<owned_message_type> m_qMessagesIn;
+
+    // Auto reconnect state, only used when EnableAutoReconnect() was called
+    std::optional<reconnect_policy> m_reconnect;
+    std::vector<typename Protocol::endpoint> m_endpoints;
+    asio::steady_timer m_timerReconnect{m_context};
+    uint32_t m_nReconnectAttempt = 0;
+    std::minstd_rand m_rng{std::random_device{}()};
+
+    // UDP side channel, see EnableUnreliableChannel(). Asio thread only.
+    size_t m_nUdpMtu = 0;
+    std::optional<asio::ip::udp::socket> m_udpSocket;
+    std::shared_ptr<udp_channel<T>> m_udpChannel;
+    asio::ip::udp::endpoint m_udpSender;
+    std::array<uint8_t, 65536> m_udpBuffer;
+    asio::steady_timer m_timerUdpHello{m_context};
+    uint32_t m_nUdpHelloAttempts = 0;
+
+    // Guards m_connection, m_bConnected and the pending messages
+    std::mutex m_muxConnection;
+    bool m_bConnected = false;
+    bool m_bStopping  = false;
+    std::deque<message<T>> m_deqPending;
 };
-}  // namespace olc::net
\ No newline at end of file
+}  // namespace olc::net
@@ -24,3 +24,7 @@
 #include <asio.hpp>
 #include <asio/ts/buffer.hpp>
 #include <asio/ts/internet.hpp>
+
+#include "async_log.h"
+#include "io_threads.h"
+#include "trace.h"
@@ -9,29 +9,47 @@
  *
  */
 #pragma once
+#include <functional>
 #include <memory>
 
 #include "asio/io_context.hpp"
 #include "asio/read.hpp"
+#include "net_capture.h"
 #include "net_message.h"
+#include "net_rate_limit.h"
+#include "net_socket_options.h"
 #include "net_tsqueue.h"
+#include "net_udp_channel.h"
 
 namespace olc::net {
 
-template <typename T>
-class connection : public std::enable_shared_from_this<connection<T>> {
+//* Protocol은 asio의 stream protocol이다 (asio::ip::tcp,
+//* asio::local::stream_protocol 등). 같은 호스트의 peer끼리는 Unix domain
+//* socket을 사용하면 loopback TCP 스택을 거치지 않는다. 기본값 (tcp)은
+//* net_message.h의 전방 선언에 있다.
+//*
+//* connection은 항상 std::shared_ptr로 만든다. 비동기 핸들러가 shared_ptr을
+//* 잡고 있으므로 소유자가 놓아도 남은 핸들러가 모두 끝날 때까지 살아 있다.
+template <typename T, typename Protocol>
+class connection
+    : public std::enable_shared_from_this<connection<T, Protocol>> {
  public:
     // A connection is "owned" by either a server or a client, and its
     // behaviour is slightly different bewteen the two.
     enum class owner { server, client };
 
+    using protocol_type      = Protocol;
+    using socket_type        = typename Protocol::socket;
+    using owned_message_type = owned_message<T, connection<T, Protocol>>;
+
     // Constructor: Specify Owner, connect to context, transfer the socket
     //				Provide reference to incoming message queue
-    connection(owner parent, asio::io_context& asioContext,
-               asio::ip::tcp::socket socket, tsqueue<owned_message<T>>& qIn)
+    connection(owner parent, asio::io_context& asioContext, socket_type socket,
+               tsqueue<owned_message_type>& qIn)
         : m_asioContext(asioContext),
           m_socket(std::move(socket)),
-          m_qMessagesIn(qIn) {
+          m_qMessagesIn(qIn),
+          m_timerThrottle(asioContext) {
         m_nOwnerType = parent;  // NOLINT
     }
 
@@ -43,72 +61,251 @@ class connection : public std::enable_shared_from_this<connection<T>> {
 
     void ConnectToClient(uint32_t uid = 0) {
         if (m_nOwnerType == owner::server) {
+            //* 소켓이 없는 connection도 ID는 가진다 (캡처 재생용 대역).
+            id = uid;
             if (m_socket.is_open()) {
-                id = uid;
+                CacheEndpoints();
                 ReadHeader();
             }
         }
     }
 
-    void ConnectToServer(
-        const asio::ip::tcp::resolver::results_type& endpoints) {
+    // onConnected is called on the asio thread once the connection is made.
+    // A failed attempt is reported through the disconnect handler. endpoints
+    // is any sequence of Protocol::endpoint (e.g. resolver results), tried in
+    // turn.
+    template <typename EndpointSequence>
+    void ConnectToServer(const EndpointSequence& endpoints,
+                         std::function<void()> onConnected = nullptr) {
         // Only clients can connect to servers
         if (m_nOwnerType == owner::client) {
-            // Request asio attempts to connect to an endpoint
-            asio::async_connect(
-                m_socket, endpoints,
-                [this](std::error_code ec, asio::ip::tcp::endpoint endpoint) {
-                    if (!ec) {
-                        ReadHeader();
-                    }
-                });
+            auto vecEndpoints =
+                std::make_shared<std::vector<typename Protocol::endpoint>>(
+                    std::begin(endpoints), std::end(endpoints));
+            if (vecEndpoints->empty()) {
+                asio::post(m_asioContext,
+                           [this, self = this->shared_from_this()]() {
+                               CloseOnError();
+                           });
+                return;
+            }
+            ConnectToEndpoint(std::move(vecEndpoints), 0,
+                              std::move(onConnected));
+        }
+    }
+
+    // Called on the asio thread for every complete incoming message before it
+    // is queued. Returning true consumes the message, so it is not queued.
+    void SetIncomingFilter(std::function<bool(message<T>&)> filter) {
+        m_incomingFilter = std::move(filter);
+    }
+
+    // Called on the asio thread, at most once, when the socket is closed
+    // because a read, write or connect failed. A requested Disconnect() does
+    // not trigger it.
+    void SetDisconnectHandler(std::function<void()> handler) {
+        m_onDisconnect = std::move(handler);
+    }
+
+    // Set the socket option policy. On the server side the socket is already
+    // connected and got its buffer sizes from the acceptor, the rest is
+    // applied right away. A client applies it while it connects.
+    void SetSocketOptions(const socket_options& options) {
+        m_socketOptions = options;
+        if (m_socket.is_open()) {
+            m_socketOptions.apply(m_socket);
+        }
+    }
+
+    // Enforce receive limits on this connection, before a message is queued.
+    // Must be set before the connection starts reading.
+    void SetRateLimit(const rate_limit_policy& policy) {
+        if (policy.enabled()) {
+            m_rateLimiter.emplace(policy);
+        } else {
+            m_rateLimiter.reset();
         }
     }
 
     void Disconnect() {
         if (IsConnected()) {
-            asio::post(m_asioContext, [this]() { m_socket.close(); });
+            asio::post(m_asioContext,
+                       [this, self = this->shared_from_this()]() {
+                           m_bClosing = true;
+                           m_socket.close();
+                       });
         }
     }
 
     [[nodiscard]] bool IsConnected() const { return m_socket.is_open(); }
 
+    // The io context every handler of this connection runs on
+    asio::io_context& GetContext() { return m_asioContext; }
+
+    // Both ends of the socket, as of the moment the connection was made
+    const typename Protocol::endpoint& GetLocalEndpoint() const {
+        return m_localEndpoint;
+    }
+    const typename Protocol::endpoint& GetRemoteEndpoint() const {
+        return m_remoteEndpoint;
+    }
+
+#if defined(OLC_NET_HAS_CAPTURE)
+    // Record every message this connection is about to queue, see
+    // net_capture.h. Must be set before the connection starts reading.
+    void SetCapture(capture_writer* capture) { m_capture = capture; }
+#endif
+
+    // Attach the negotiated UDP side channel (see net_udp_channel.h)
+    void SetUdpChannel(std::shared_ptr<udp_channel<T>> channel) {
+        std::atomic_store(&m_udpChannel, std::move(channel));
+    }
+
+    std::shared_ptr<udp_channel<T>> GetUdpChannel() const {
+        return std::atomic_load(&m_udpChannel);
+    }
+
+    // Server side, the token a client proves this connection with on the UDP
+    // side channel. Set before the connection starts.
+    void SetUdpToken(uint64_t nToken) { m_nUdpToken = nToken; }
+    uint64_t GetUdpToken() const { return m_nUdpToken; }
+
     // Prime the connection to wait for incoming messages
     void StartListening() {}
 
     // ASYNC - Send a message, connections are one-to-one so no need to specifiy
     // the target, for a client, the target is the server and vice versa
     void Send(const message<T>& msg) {
-        asio::post(m_asioContext, [this, msg]() {
-            // If the queue has a message in it, then we must
-            // assume that it is in the process of asynchronously being written.
-            // Either way add the message to the queue to be output. If no
-            // messages were available to be written, then start the process of
-            // writing the message at the front of the queue.
-            bool bWritingMessage = !m_qMessagesOut.empty();
-            m_qMessagesOut.push_back(msg);
-            if (!bWritingMessage) {
-                WriteHeader();
+        // The message is copied once into a frame, from then on only the
+        // pointer moves around
+        asio::post(m_asioContext,
+                   [this, self = this->shared_from_this(),
+                    frame = std::make_shared<const message<T>>(msg)]() {
+                       EnqueueFrame(frame);
+                   });
+    }
+
+    // ASYNC - Send a frame that may be shared with other connections (e.g. a
+    // broadcast), the message itself is never copied. When called on this
+    // connection's io thread the frame is queued right away.
+    void Send(std::shared_ptr<const message<T>> frame) {
+        asio::dispatch(m_asioContext, [this, self = this->shared_from_this(),
+                                       frame = std::move(frame)]() {
+            EnqueueFrame(frame);
+        });
+    }
+
+    // ASYNC - Send over the UDP side channel, for state that is superseded by
+    // the next message of the same id (e.g. snapshots). It may be lost, and a
+    // copy that arrives after a newer one is dropped. Goes over TCP instead
+    // while there is no side channel, or if it is too large for one.
+    void SendUnreliable(const message<T>& msg) {
+        std::shared_ptr<udp_channel<T>> udp = GetUdpChannel();
+        if (!udp || !udp->send(msg)) {
+            Send(msg);
+        }
+    }
+
+    // Hand over a message that arrived on the side channel. It is checked
+    // against the rate limit, filtered and queued on this connection's asio
+    // thread exactly like one read from the socket. A datagram cannot be held
+    // back, so the throttle action drops it instead (without running up the
+    // sender's debt).
+    void DeliverUnreliable(message<T> msg) {
+        asio::post(m_asioContext, [this, self = this->shared_from_this(),
+                                   msg = std::move(msg)]() mutable {
+            if (!m_socket.is_open()) {
+                return;
+            }
+            if (m_rateLimiter &&
+                m_rateLimiter->admit_or_drop(
+                    static_cast<uint32_t>(msg.header.id),
+                    sizeof(message_header<T>) + msg.body.size()) >
+                    rate_limiter::clock::duration::zero()) {
+                if (m_rateLimiter->action() == rate_limit_action::disconnect) {
+                    alog::warn("[", id, "] Rate Limit Exceeded.");
+                    CloseOnError();
+                }
+                return;
             }
+            QueueIncoming(msg);
         });
     }
 
  private:
+    //* asio::async_connect는 끝점마다 소켓을 새로 열기 때문에 버퍼 크기를
+    //* 미리 정할 수 없다. 그래서 직접 끝점마다 소켓을 열고 SYN이 나가기 전에
+    //* 버퍼 크기를 정한 뒤 연결한다 (window scale이 이때 정해진다).
+    void ConnectToEndpoint(
+        std::shared_ptr<std::vector<typename Protocol::endpoint>> endpoints,
+        size_t index, std::function<void()> onConnected) {
+        const auto& endpoint = (*endpoints)[index];
+        asio::error_code ec;
+        m_socket.close(ec);
+        m_socket.open(endpoint.protocol(), ec);
+        if (!ec) {
+            m_socketOptions.apply_buffers(m_socket);
+        }
+
+        // Request asio attempts to connect to an endpoint
+        m_socket.async_connect(
+            endpoint, [this, self = this->shared_from_this(), endpoints, index,
+                       onConnected](asio::error_code ec) {
+                if (!ec) {
+                    m_socketOptions.apply(m_socket);
+                    CacheEndpoints();
+                    ReadHeader();
+                    if (onConnected) {
+                        onConnected();
+                    }
+                } else if (ec != asio::error::operation_aborted &&
+                           index + 1 < endpoints->size()) {
+                    ConnectToEndpoint(endpoints, index + 1, onConnected);
+                } else {
+                    CloseOnError();
+                }
+            });
+    }
+
+    void CacheEndpoints() {
+        asio::error_code ec;
+        m_localEndpoint  = m_socket.local_endpoint(ec);
+        m_remoteEndpoint = m_socket.remote_endpoint(ec);
+    }
+
+    // ASIO THREAD
+    void EnqueueFrame(const std::shared_ptr<const message<T>>& frame) {
+        // If the queue has a message in it, then we must
+        // assume that it is in the process of asynchronously being written.
+        // Either way add the message to the queue to be output. If no
+        // messages were available to be written, then start the process of
+        // writing the message at the front of the queue.
+        bool bWritingMessage = !m_qMessagesOut.empty();
+        m_qMessagesOut.push_back(frame);
+        if (!bWritingMessage) {
+            WriteHeader();
+        }
+    }
+
     // ASYNC - Prime context to write a message header
     void WriteHeader() {
         // If this function is called, we know the outgoing message queue must
         // have at least one message to send. So allocate a transmission buffer
         // to hold the message, and issue the work - asio, send these bytes
+        TRACE_BEGIN("WriteHeader", reinterpret_cast<uintptr_t>(this));
         asio::async_write(m_socket,
-                          asio::buffer(&m_qMessagesOut.front().header,
+                          asio::buffer(&m_qMessagesOut.front()->header,
                                        sizeof(message_header<T>)),
-                          [this](std::error_code ec, std::size_t length) {
+                          [this, self = this->shared_from_this()](
+                              std::error_code ec, std::size_t length) {
+                              TRACE_END("WriteHeader",
+                                        reinterpret_cast<uintptr_t>(this));
                               // asio has now sent the bytes - if there was a
                               // problem an error would be available...
                               if (!ec) {
                                   // ... no error, so check if the message
                                   // header just sent also has a message body...
-                                  if (m_qMessagesOut.front().body.size() > 0) {
+                                  if (m_qMessagesOut.front()->body.size() > 0) {
                                       // ...it does, so issue the task to write
                                       // the body bytes
                                       WriteBody();
@@ -133,9 +330,8 @@ class connection : public std::enable_shared_from_this<connection<T>> {
                                   // socket. When a future attempt to write to
                                   // this client fails due to the closed socket,
                                   // it will be tidied up.
-                                  std::cout << "[" << id
-                                            << "] Write Header Fail.\n";
-                                  m_socket.close();
+                                  alog::warn("[", id, "] Write Header Fail.");
+                                  CloseOnError();
                               }
                           });
     }
@@ -145,10 +341,14 @@ class connection : public std::enable_shared_from_this<connection<T>> {
         // If this function is called, a header has just been sent, and that
         // header indicated a body existed for this message. Fill a transmission
         // buffer with the body data, and send it!
+        TRACE_BEGIN("WriteBody", reinterpret_cast<uintptr_t>(this));
         asio::async_write(m_socket,
-                          asio::buffer(m_qMessagesOut.front().body.data(),
-                                       m_qMessagesOut.front().body.size()),
-                          [this](std::error_code ec, std::size_t length) {
+                          asio::buffer(m_qMessagesOut.front()->body.data(),
+                                       m_qMessagesOut.front()->body.size()),
+                          [this, self = this->shared_from_this()](
+                              std::error_code ec, std::size_t length) {
+                              TRACE_END("WriteBody",
+                                        reinterpret_cast<uintptr_t>(this));
                               if (!ec) {
                                   // Sending was successful, so we are done with
                                   // the message and remove it from the queue
@@ -163,9 +363,8 @@ class connection : public std::enable_shared_from_this<connection<T>> {
                               } else {
                                   // Sending failed, see WriteHeader()
                                   // equivalent for description :P
-                                  std::cout << "[" << id
-                                            << "] Write Body Fail.\n";
-                                  m_socket.close();
+                                  alog::warn("[", id, "] Write Body Fail.");
+                                  CloseOnError();
                               }
                           });
     }
@@ -177,11 +376,16 @@ class connection : public std::enable_shared_from_this<connection<T>> {
         // headers are a fixed size, so allocate a transmission buffer large
         // enough to store it. In fact, we will construct the message in a
         // "temporary" message object as it's convenient to work with.
+        TRACE_BEGIN("ReadHeader", reinterpret_cast<uintptr_t>(this));
         asio::async_read(
             m_socket,
             asio::buffer(&m_msgTemporaryIn.header, sizeof(message_header<T>)),
-            [this](std::error_code ec, std::size_t length) {
+            [this, self = this->shared_from_this()](std::error_code ec,
+                                                    std::size_t length) {
+                TRACE_END("ReadHeader", reinterpret_cast<uintptr_t>(this));
                 if (!ec) {
+                    m_socketOptions.rearm_quickack(m_socket);
+
                     // A complete message header has been read, check if this
                     // message has a body to follow...
                     if (m_msgTemporaryIn.header.size > 0) {
@@ -193,15 +397,17 @@ class connection : public std::enable_shared_from_this<connection<T>> {
                         ReadBody();
                     } else {
                         // it doesn't, so add this bodyless message to the
-                        // connections incoming message queue
+                        // connections incoming message queue. Drop whatever
+                        // body the previous message left behind first.
+                        m_msgTemporaryIn.body.clear();
                         AddToIncomingMessageQueue();
                     }
                 } else {
                     // Reading form the client went wrong, most likely a
                     // disconnect has occurred. Close the socket and let the
                     // system tidy it up later.
-                    std::cout << "[" << id << "] Read Header Fail.\n";
-                    m_socket.close();
+                    alog::warn("[", id, "] Read Header Fail.");
+                    CloseOnError();
                 }
             });
     }
@@ -212,10 +418,14 @@ class connection : public std::enable_shared_from_this<connection<T>> {
         // header request we read a body, The space for that body has already
         // been allocated in the temporary message object, so just wait for the
         // bytes to arrive...
+        TRACE_BEGIN("ReadBody", reinterpret_cast<uintptr_t>(this));
         asio::async_read(m_socket,
                          asio::buffer(m_msgTemporaryIn.body.data(),
                                       m_msgTemporaryIn.body.size()),
-                         [this](std::error_code ec, std::size_t length) {
+                         [this, self = this->shared_from_this()](
+                             std::error_code ec, std::size_t length) {
+                             TRACE_END("ReadBody",
+                                       reinterpret_cast<uintptr_t>(this));
                              if (!ec) {
                                  // ...and they have! The message is now
                                  // complete, so add the whole message to
@@ -223,50 +433,134 @@ class connection : public std::enable_shared_from_this<connection<T>> {
                                  AddToIncomingMessageQueue();
                              } else {
                                  // As above!
-                                 std::cout << "[" << id
-                                           << "] Read Body Fail.\n";
-                                 m_socket.close();
+                                 alog::warn("[", id, "] Read Body Fail.");
+                                 CloseOnError();
                              }
                          });
     }
 
-    // Once a full message is received, add it to the incoming queue
-    void AddToIncomingMessageQueue() {
+    // The connection has died, close the socket and let the owner know once
+    void CloseOnError() {
+        m_socket.close();
+        if (!m_bClosing) {
+            m_bClosing = true;
+            if (m_onDisconnect) {
+                m_onDisconnect();
+            }
+        }
+    }
+
+    // ASIO THREAD - Record, filter and queue a message that has been admitted
+    void QueueIncoming(message<T>& msg) {
+#if defined(OLC_NET_HAS_CAPTURE)
+        if (m_capture) {
+            m_capture->record(id, msg);
+        }
+#endif
+
         // Shove it in queue, converting it to an "owned message", by
         // initialising with the a shared pointer from this connection object
-        if (m_nOwnerType == owner::server) {
-            m_qMessagesIn.push_back(
-                {this->shared_from_this(), m_msgTemporaryIn});
+        if (m_incomingFilter && m_incomingFilter(msg)) {
+            // ...unless the owner has already consumed it
+        } else if (m_nOwnerType == owner::server) {
+            m_qMessagesIn.push_back({this->shared_from_this(), msg});
         } else {
             //* 클라이언트인 경우, 별도의 remote side에 대한 포인터가 필요없다.
             //* 어차피 하나의 connection만 갖는다.
-            m_qMessagesIn.push_back({nullptr, m_msgTemporaryIn});
+            m_qMessagesIn.push_back({nullptr, msg});
         }
+    }
+
+    // Once a full message is received, add it to the incoming queue
+    void AddToIncomingMessageQueue() {
+        // Check the sender is within its limits first
+        auto throttle = rate_limiter::clock::duration::zero();
+        if (m_rateLimiter) {
+            throttle = m_rateLimiter->admit(
+                static_cast<uint32_t>(m_msgTemporaryIn.header.id),
+                sizeof(message_header<T>) + m_msgTemporaryIn.body.size());
+        }
+        if (throttle > throttle.zero()) {
+            switch (m_rateLimiter->action()) {
+                case rate_limit_action::throttle:
+                    // Still queued, see below
+                    break;
+                case rate_limit_action::drop:
+                    ReadHeader();
+                    return;
+                case rate_limit_action::disconnect:
+                    alog::warn("[", id, "] Rate Limit Exceeded.");
+                    CloseOnError();
+                    return;
+            }
+        }
+
+        QueueIncoming(m_msgTemporaryIn);
 
         // We must now prime the asio context to receive the next message. It
         // wil just sit and wait for bytes to arrive, and the message
         // construction process repeats itself. Clever huh?
-        ReadHeader();
+        if (throttle > throttle.zero()) {
+            // ...unless the sender is over its limits. Leave the next message
+            // in the socket until the buckets have refilled.
+            m_timerThrottle.expires_after(throttle);
+            m_timerThrottle.async_wait(
+                [this, self = this->shared_from_this()](std::error_code ec) {
+                    if (!ec && m_socket.is_open()) {
+                        ReadHeader();
+                    }
+                });
+        } else {
+            ReadHeader();
+        }
     }
 
  protected:
     // Each connection has a unique socket to a remote
-    asio::ip::tcp::socket m_socket;
+    socket_type m_socket;
 
     // This context is shared with the whole asio instance
     asio::io_context& m_asioContext;
 
     // This queue holds all messages to be sent to the remote side
-    // of this connection
-    tsqueue<message<T>> m_qMessagesOut;
+    // of this connection. Frames are immutable and may be shared by several
+    // connections.
+    tsqueue<std::shared_ptr<const message<T>>> m_qMessagesOut;
 
     // This references the incoming queue of the parent object
-    tsqueue<owned_message<T>>& m_qMessagesIn;
+    tsqueue<owned_message_type>& m_qMessagesIn;
 
     // Incoming messages are constructed asynchronously, so we will
     // store the part assembled message here, until it is ready
     message<T> m_msgTemporaryIn;
 
+    // Socket options policy given by the owning server/client
+    socket_options m_socketOptions;
+
+    // See SetIncomingFilter()
+    std::function<bool(message<T>&)> m_incomingFilter;
+
+    // Receive limits, only touched on the asio thread (see SetRateLimit())
+    std::optional<rate_limiter> m_rateLimiter;
+    asio::steady_timer m_timerThrottle;
+
+    // See GetLocalEndpoint() and GetRemoteEndpoint()
+    typename Protocol::endpoint m_localEndpoint;
+    typename Protocol::endpoint m_remoteEndpoint;
+
+#if defined(OLC_NET_HAS_CAPTURE)
+    // See SetCapture(), owned by the server
+    capture_writer* m_capture = nullptr;
+#endif
+
+    // Optional UDP side channel, set from the thread that negotiated it
+    std::shared_ptr<udp_channel<T>> m_udpChannel;
+    uint64_t m_nUdpToken = 0;
+
+    // Notified when the connection dies, see SetDisconnectHandler()
+    std::function<void()> m_onDisconnect;
+    bool m_bClosing = false;
+
     // The "owner" decides how some of the connection behaves
     owner m_nOwnerType = owner::server;
 
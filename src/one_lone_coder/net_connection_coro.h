@@ -0,0 +1,195 @@
+/**
+ * @file net_connection_coro.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief C++20 코루틴 (asio::awaitable/co_spawn) 기반 connection 구현
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <memory>
+
+#include <asio.hpp>
+
+#include "net_message.h"
+#include "net_tsqueue.h"
+
+#if defined(ASIO_HAS_CO_AWAIT)
+
+namespace olc::net::coro {
+
+//* 콜백 기반 connection<T>와 같은 인터페이스를 제공하지만
+//* ReadHeader->ReadBody->AddToIncomingMessageQueue->ReadHeader로 이어지는
+//* 콜백 체인 대신 읽기/쓰기 루프를 각각 하나의 코루틴으로 작성한다.
+//* 각 루프는 shared_from_this()를 붙잡고 있으므로 진행 중인 연산이 있는 동안
+//* 객체가 사라지지 않는다. (따라서 반드시 shared_ptr로 생성해야 한다.)
+//*
+//* 루프 코루틴은 연결 당 한번만 생성되므로 메세지마다 프레임을 새로 할당하지
+//* 않는다. 루프 안에서 co_await하는 각 연산의 프레임은 asio가 스레드 별로
+//* 재활용하는 할당자 (awaitable frame recycling)를 사용하고, 수신 버퍼는
+//* m_msgTemporaryIn의 capacity를 그대로 재사용한다.
+template <typename T>
+class connection : public std::enable_shared_from_this<connection<T>> {
+ public:
+    enum class owner { server, client };
+
+    using owned_message_type = owned_message<T, connection<T>>;
+
+    connection(owner parent, asio::io_context& asioContext,
+               asio::ip::tcp::socket socket, tsqueue<owned_message_type>& qIn)
+        : m_socket(std::move(socket)),
+          m_asioContext(asioContext),
+          m_timerWrite(asioContext),
+          m_qMessagesIn(qIn),
+          m_nOwnerType(parent) {
+        // 쓰기 루프는 이 타이머를 조건 변수처럼 사용한다. Send()에서 타이머를
+        // 취소하면 대기 중이던 쓰기 루프가 깨어난다.
+        m_timerWrite.expires_at(asio::steady_timer::time_point::max());
+    }
+
+    virtual ~connection() {}
+
+    [[nodiscard]] uint32_t GetID() const { return id; }
+
+    void ConnectToClient(uint32_t uid = 0) {
+        if (m_nOwnerType == owner::server) {
+            if (m_socket.is_open()) {
+                id = uid;
+                StartLoops();
+            }
+        }
+    }
+
+    void ConnectToServer(
+        const asio::ip::tcp::resolver::results_type& endpoints) {
+        if (m_nOwnerType == owner::client) {
+            asio::co_spawn(
+                m_asioContext,
+                [self = this->shared_from_this(),
+                 endpoints]() -> asio::awaitable<void> {
+                    asio::error_code ec;
+                    co_await asio::async_connect(
+                        self->m_socket, endpoints,
+                        asio::redirect_error(asio::use_awaitable, ec));
+                    if (!ec) {
+                        self->StartLoops();
+                    }
+                },
+                asio::detached);
+        }
+    }
+
+    void Disconnect() {
+        if (IsConnected()) {
+            asio::post(m_asioContext,
+                       [self = this->shared_from_this()]() { self->Close(); });
+        }
+    }
+
+    [[nodiscard]] bool IsConnected() const { return m_socket.is_open(); }
+
+    // ASYNC - 메세지를 송신 큐에 넣고 쓰기 루프를 깨운다.
+    void Send(const message<T>& msg) {
+        asio::post(m_asioContext, [self = this->shared_from_this(), msg]() {
+            self->m_qMessagesOut.push_back(msg);
+            self->m_timerWrite.cancel_one();
+        });
+    }
+
+ private:
+    void StartLoops() {
+        asio::co_spawn(m_asioContext, ReadLoop(this->shared_from_this()),
+                       asio::detached);
+        asio::co_spawn(m_asioContext, WriteLoop(this->shared_from_this()),
+                       asio::detached);
+    }
+
+    void Close() {
+        asio::error_code ec;
+        m_socket.close(ec);
+        m_timerWrite.cancel();
+    }
+
+    // 헤더를 읽고, 바디가 있으면 바디를 읽은 후 수신 큐에 넣는 과정을 반복한다.
+    // self는 이 코루틴이 살아있는 동안 connection 객체를 살려둔다.
+    asio::awaitable<void> ReadLoop(std::shared_ptr<connection> self) {
+        try {
+            for (;;) {
+                co_await asio::async_read(
+                    m_socket,
+                    asio::buffer(&m_msgTemporaryIn.header,
+                                 sizeof(message_header<T>)),
+                    asio::use_awaitable);
+
+                // resize는 capacity를 줄이지 않으므로 이전 메세지에서 잡아둔
+                // 버퍼를 그대로 재사용한다.
+                m_msgTemporaryIn.body.resize(m_msgTemporaryIn.header.size);
+                if (m_msgTemporaryIn.header.size > 0) {
+                    co_await asio::async_read(
+                        m_socket,
+                        asio::buffer(m_msgTemporaryIn.body.data(),
+                                     m_msgTemporaryIn.body.size()),
+                        asio::use_awaitable);
+                }
+
+                if (m_nOwnerType == owner::server) {
+                    m_qMessagesIn.push_back({self, m_msgTemporaryIn});
+                } else {
+                    m_qMessagesIn.push_back({nullptr, m_msgTemporaryIn});
+                }
+            }
+        } catch (std::exception& e) {
+            alog::warn("[", id, "] Read Fail.");
+            Close();
+        }
+    }
+
+    // 송신 큐가 빌 때까지 메세지를 보내고, 비어 있으면 Send()가 깨워줄 때까지
+    // 기다린다. 헤더와 바디는 gather write 한번으로 보낸다.
+    asio::awaitable<void> WriteLoop(std::shared_ptr<connection> /*self*/) {
+        try {
+            while (m_socket.is_open()) {
+                if (m_qMessagesOut.empty()) {
+                    asio::error_code ec;
+                    co_await m_timerWrite.async_wait(
+                        asio::redirect_error(asio::use_awaitable, ec));
+                    continue;
+                }
+
+                const message<T>& msg = m_qMessagesOut.front();
+                std::array<asio::const_buffer, 2> buffers = {
+                    asio::buffer(&msg.header, sizeof(message_header<T>)),
+                    asio::buffer(msg.body.data(), msg.body.size())};
+                co_await asio::async_write(m_socket, buffers,
+                                           asio::use_awaitable);
+                m_qMessagesOut.pop_front();
+            }
+        } catch (std::exception& e) {
+            alog::warn("[", id, "] Write Fail.");
+            Close();
+        }
+    }
+
+ protected:
+    asio::ip::tcp::socket m_socket;
+
+    asio::io_context& m_asioContext;
+
+    // 쓰기 루프를 깨우기 위한 타이머
+    asio::steady_timer m_timerWrite;
+
+    tsqueue<message<T>> m_qMessagesOut;
+
+    tsqueue<owned_message_type>& m_qMessagesIn;
+
+    message<T> m_msgTemporaryIn;
+
+    owner m_nOwnerType = owner::server;
+
+    uint32_t id = 0;
+};
+}  // namespace olc::net::coro
+
+#endif  // ASIO_HAS_CO_AWAIT
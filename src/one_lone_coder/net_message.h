@@ -24,6 +24,9 @@ template <typename T>
 struct message_header {
     T id{};
     uint32_t size = 0;
+    // Non zero for request/response traffic (see net_rpc.h). A reply carries
+    // the correlation id of the request it answers.
+    uint32_t correlation_id = 0;
 };
 
 // Message Body contains a header and a std::vector, containing raw bytes
@@ -112,18 +115,24 @@ struct message {
 // with a connection. On a server, the owner would be the client that sent the
 // message, on a client the owner would be the server.
 
-// Forward declare the connection
-template <typename T>
+// Forward declare the connection, it runs over TCP unless told otherwise
+template <typename T, typename Protocol = asio::ip::tcp>
 class connection;
 
-template <typename T>
+//* 기본은 콜백 기반 connection이지만, 코루틴 기반 connection 등 다른 구현도
+//* 같은 메세지 큐 구조를 사용할 수 있도록 connection 타입을 인자로 받는다.
+template <typename T, typename ConnectionT = connection<T>>
 struct owned_message {
-    std::shared_ptr<connection<T>> remote = nullptr;
+    std::shared_ptr<ConnectionT> remote = nullptr;
     message<T> msg;
+#if defined(ENABLE_TRACE)
+    // When the message was queued, for the "queue wait" span in Update()
+    uint64_t trace_queued_ns = trace::now_ns();
+#endif
 
     // Again, a friendly string maker
     friend std::ostream& operator<<(std::ostream& os,
-                                    const owned_message<T>& msg) {
+                                    const owned_message& msg) {
         os << msg.msg;
         return os;
     }
@@ -0,0 +1,170 @@
+/**
+ * @file net_rate_limit.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 수신 경로에 적용하는 연결 별 token bucket 속도 제한
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace olc::net {
+
+// rate per second, up to burst tokens can be saved up
+struct rate_limit {
+    double rate  = 0.0;
+    double burst = 0.0;
+};
+
+// What a connection does with a message that is over its limit
+enum class rate_limit_action {
+    throttle,   // queue it, but delay reading the next message until the
+                // buckets have refilled (TCP pushes back on the sender).
+                // A datagram is dropped instead.
+    drop,       // silently discard it
+    disconnect  // close the connection
+};
+
+// Receive limits of a connection. Unset limits are not enforced. Bursts should
+// be at least as large as the largest message, or that message never fits
+// under the drop/disconnect actions.
+struct rate_limit_policy {
+    std::optional<rate_limit> messages_per_sec;
+    std::optional<rate_limit> bytes_per_sec;  // header + body
+
+    // Additional message count limit per message id, keyed by the id cast to
+    // uint32_t
+    std::unordered_map<uint32_t, rate_limit> per_id_messages_per_sec;
+
+    rate_limit_action action = rate_limit_action::throttle;
+
+    bool enabled() const {
+        return messages_per_sec || bytes_per_sec ||
+               !per_id_messages_per_sec.empty();
+    }
+};
+
+//* 연결마다 하나씩 가지며 그 연결의 asio 스레드에서만 사용하므로 잠금이
+//* 없다. bucket은 시간이 지난 만큼 채워지고 (최대 burst), 메세지가 들어올
+//* 때마다 비워진다.
+class rate_limiter {
+ public:
+    using clock = std::chrono::steady_clock;
+
+    explicit rate_limiter(const rate_limit_policy& policy)
+        : m_action(policy.action) {
+        auto now = clock::now();
+        if (policy.messages_per_sec) {
+            m_messages = bucket(*policy.messages_per_sec, now);
+        }
+        if (policy.bytes_per_sec) {
+            m_bytes = bucket(*policy.bytes_per_sec, now);
+        }
+        for (const auto& [id, limit] : policy.per_id_messages_per_sec) {
+            m_perId.emplace(id, bucket(limit, now));
+        }
+    }
+
+    rate_limit_action action() const { return m_action; }
+
+    // Account for an incoming message. Returns zero if it is within the
+    // limits, otherwise how long the sender is over them. A message over the
+    // limits only takes tokens under the throttle action, which lets the
+    // buckets go into debt that the returned delay pays back.
+    clock::duration admit(uint32_t id, size_t bytes,
+                          clock::time_point now = clock::now()) {
+        return Admit(id, bytes, now,
+                     m_action == rate_limit_action::throttle);
+    }
+
+    // Like admit(), but a message over the limits never takes tokens, for
+    // one that cannot be delayed and is dropped instead (e.g. a datagram)
+    clock::duration admit_or_drop(uint32_t id, size_t bytes,
+                                  clock::time_point now = clock::now()) {
+        return Admit(id, bytes, now, false);
+    }
+
+ private:
+    clock::duration Admit(uint32_t id, size_t bytes, clock::time_point now,
+                          bool bTakeOnDeficit) {
+        bucket* idBucket = nullptr;
+        if (auto it = m_perId.find(id); it != m_perId.end()) {
+            idBucket = &it->second;
+        }
+
+        double wait = 0.0;
+        if (m_messages) {
+            wait = std::max(wait, m_messages->deficit(1.0, now));
+        }
+        if (m_bytes) {
+            wait = std::max(wait, m_bytes->deficit(double(bytes), now));
+        }
+        if (idBucket) {
+            wait = std::max(wait, idBucket->deficit(1.0, now));
+        }
+
+        if (wait > 0.0 && !bTakeOnDeficit) {
+            return ToDuration(wait);
+        }
+
+        if (m_messages) {
+            m_messages->tokens -= 1.0;
+        }
+        if (m_bytes) {
+            m_bytes->tokens -= double(bytes);
+        }
+        if (idBucket) {
+            idBucket->tokens -= 1.0;
+        }
+        return ToDuration(wait);
+    }
+
+    // Never rounds a positive wait down to zero
+    static clock::duration ToDuration(double seconds) {
+        if (seconds <= 0.0) {
+            return clock::duration::zero();
+        }
+        return std::max(clock::duration(1),
+                        std::chrono::duration_cast<clock::duration>(
+                            std::chrono::duration<double>(seconds)));
+    }
+
+    struct bucket {
+        bucket(const rate_limit& limit, clock::time_point now)
+            : rate(limit.rate),
+              capacity(limit.burst),
+              tokens(limit.burst),
+              last(now) {}
+
+        // Refill for the time passed, then return the seconds until n tokens
+        // are available (0 if they are now)
+        double deficit(double n, clock::time_point now) {
+            std::chrono::duration<double> elapsed = now - last;
+            last   = now;
+            tokens = std::min(capacity, tokens + elapsed.count() * rate);
+            if (tokens >= n) {
+                return 0.0;
+            }
+            return rate > 0.0 ? (n - tokens) / rate : 1.0;
+        }
+
+        double rate;
+        double capacity;
+        double tokens;
+        clock::time_point last;
+    };
+
+    rate_limit_action m_action;
+    std::optional<bucket> m_messages;
+    std::optional<bucket> m_bytes;
+    std::unordered_map<uint32_t, bucket> m_perId;
+};
+
+}  // namespace olc::net
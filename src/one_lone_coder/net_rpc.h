@@ -0,0 +1,197 @@
+/**
+ * @file net_rpc.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief correlation id를 이용한 request/response (RPC) 계층
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "net_client.h"
+#include "net_common.h"
+#include "net_message.h"
+
+namespace olc::net {
+
+// Server side helper - make a reply message answer the given request
+template <typename T>
+void SetReplyTo(message<T>& reply, const message<T>& request) {
+    reply.header.correlation_id = request.header.correlation_id;
+}
+
+//* Incoming()을 폴링하면서 header.id로 응답을 찾는 대신, 요청마다 correlation
+//* id를 헤더에 찍어서 보내고 같은 id를 가진 응답이 오면 해당 요청을 완료한다.
+//* 하나의 연결 위에서 여러 요청이 동시에 진행될 수 있다.
+//*
+//* AsyncCall()은 asio의 completion token을 받으므로 콜백, asio::use_future,
+//* asio::use_awaitable 모두 사용할 수 있다. 완료 시그니처는
+//* void(asio::error_code, message<T>)이며, 제한 시간이 지나면
+//* asio::error::timed_out으로 완료된다.
+//*
+//* 대기 중인 요청은 slot 테이블에 저장한다. correlation id의 하위 16비트가
+//* slot 번호, 상위 16비트가 slot의 세대(generation)이므로 조회/삭제가 O(1)이고,
+//* 제한 시간이 지난 뒤에 도착한 응답은 세대가 달라서 무시된다. 테이블은
+//* asio 스레드에서만 접근하므로 잠금이 필요 없다.
+template <typename T, typename Protocol = asio::ip::tcp>
+class rpc_client : public client_interface<T, Protocol> {
+ public:
+    using client_interface<T, Protocol>::client_interface;
+
+    ~rpc_client() override {
+        // The asio thread must be gone before the pending table is destroyed
+        this->Disconnect();
+    }
+
+    template <typename CompletionToken>
+    auto AsyncCall(message<T> request, std::chrono::milliseconds timeout,
+                   CompletionToken&& token) {
+        return asio::async_initiate<CompletionToken,
+                                    void(asio::error_code, message<T>)>(
+            [this](auto handler, message<T> request,
+                   std::chrono::milliseconds timeout) {
+                asio::post(this->m_context,
+                           [this, handler = std::move(handler),
+                            request = std::move(request), timeout]() mutable {
+                               StartCall(std::move(handler), std::move(request),
+                                         timeout);
+                           });
+            },
+            token, std::move(request), timeout);
+    }
+
+    // The future throws asio::system_error if the call fails or times out
+    std::future<message<T>> Call(message<T> request,
+                                 std::chrono::milliseconds timeout) {
+        return AsyncCall(std::move(request), timeout, asio::use_future);
+    }
+
+    // The callback is invoked on the asio thread
+    void Call(message<T> request, std::chrono::milliseconds timeout,
+              std::function<void(asio::error_code, message<T>)> callback) {
+        AsyncCall(std::move(request), timeout, std::move(callback));
+    }
+
+ protected:
+    bool OnMessageReceived(message<T>& msg) override {
+        if (msg.header.correlation_id == 0) {
+            return false;
+        }
+        Complete(msg.header.correlation_id, {}, std::move(msg));
+        return true;
+    }
+
+ private:
+    // Type erased, move only completion handler
+    struct pending_handler {
+        virtual ~pending_handler() = default;
+        virtual void complete(asio::error_code ec, message<T> msg) = 0;
+    };
+
+    template <typename Handler>
+    struct pending_handler_impl : pending_handler {
+        explicit pending_handler_impl(Handler&& h, asio::io_context& ioc)
+            : handler(std::move(h)),
+              executor(asio::get_associated_executor(handler,
+                                                     ioc.get_executor())) {}
+
+        void complete(asio::error_code ec, message<T> msg) override {
+            // Resume the caller on its own executor (e.g. a coroutine's)
+            asio::dispatch(executor, [h = std::move(handler), ec,
+                                      msg = std::move(msg)]() mutable {
+                h(ec, std::move(msg));
+            });
+        }
+
+        Handler handler;
+        asio::associated_executor_t<Handler, asio::io_context::executor_type>
+            executor;
+    };
+
+    struct slot {
+        explicit slot(asio::io_context& ioc) : timer(ioc) {}
+
+        uint16_t generation = 1;
+        std::unique_ptr<pending_handler> handler;
+        asio::steady_timer timer;
+    };
+
+    static constexpr uint32_t SLOT_BITS = 16;
+    static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+    // ASIO THREAD
+    template <typename Handler>
+    void StartCall(Handler&& handler, message<T> request,
+                   std::chrono::milliseconds timeout) {
+        using handler_type = std::decay_t<Handler>;
+        auto pending = std::make_unique<pending_handler_impl<handler_type>>(
+            std::move(handler), this->m_context);
+
+        if (m_vecFree.empty() && m_vecSlots.size() > SLOT_MASK) {
+            pending->complete(asio::error::no_buffer_space, {});
+            return;
+        }
+
+        uint32_t index;
+        if (!m_vecFree.empty()) {
+            index = m_vecFree.back();
+            m_vecFree.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_vecSlots.size());
+            m_vecSlots.push_back(std::make_unique<slot>(this->m_context));
+        }
+
+        slot& s     = *m_vecSlots[index];
+        s.handler   = std::move(pending);
+        uint32_t id = (uint32_t(s.generation) << SLOT_BITS) | index;
+
+        s.timer.expires_after(timeout);
+        s.timer.async_wait([this, id](asio::error_code ec) {
+            if (!ec) {
+                Complete(id, asio::error::timed_out, {});
+            }
+        });
+
+        request.header.correlation_id = id;
+        if (!this->Send(request)) {
+            Complete(id, asio::error::not_connected, {});
+        }
+    }
+
+    // ASIO THREAD - finish the call with the given id, if still pending
+    void Complete(uint32_t id, asio::error_code ec, message<T> msg) {
+        uint32_t index = id & SLOT_MASK;
+        if (index >= m_vecSlots.size()) {
+            return;
+        }
+        slot& s = *m_vecSlots[index];
+        if (!s.handler || s.generation != (id >> SLOT_BITS)) {
+            // Late reply of a call that has already timed out
+            return;
+        }
+
+        auto handler = std::move(s.handler);
+        s.timer.cancel();
+        // Generation 0 would make an id of 0 possible, which means "no RPC",
+        // and 0xffff one of UDP_TOKEN_CORRELATION_ID
+        if (++s.generation == 0xffff) {
+            s.generation = 1;
+        }
+        m_vecFree.push_back(index);
+
+        handler->complete(ec, std::move(msg));
+    }
+
+    std::vector<std::unique_ptr<slot>> m_vecSlots;
+    std::vector<uint32_t> m_vecFree;
+};
+
+}  // namespace olc::net
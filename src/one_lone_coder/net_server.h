@@ -10,27 +10,113 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <map>
 #include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <asio.hpp>
 
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "net_capture.h"
 #include "net_common.h"
 #include "net_connection.h"
 #include "net_message.h"
+#include "net_rate_limit.h"
+#include "net_slot_map.h"
+#include "net_socket_options.h"
+#include "net_topic_index.h"
 #include "net_tsqueue.h"
+#include "net_worker_pool.h"
 
 namespace olc::net {
-template <typename T>
+//* 연결은 여러 io 스레드 (shard)에 round-robin으로 나눠 배치한다. shard마다
+//* 자신의 io_context와 자신에게 배치된 연결 목록을 가지며, 그 목록은 해당
+//* shard의 스레드에서만 접근하므로 잠금이 필요 없다. shard 0은 acceptor와
+//* 같은 m_asioContext를 사용한다.
+//*
+//* MessageAllClients()는 메세지를 한번만 복사한 공유 frame을 각 shard에
+//* 넘기고, 각 io 스레드가 자신의 연결들에 병렬로 frame을 넣는다. 따라서
+//* 호출한 스레드의 비용은 클라이언트 수가 아니라 스레드 수에 비례한다.
+//*
+//* Protocol은 connection과 같은 stream protocol이다. TCP 서버는 포트로, 그 외
+//* (예: asio::local::stream_protocol)는 endpoint로 생성한다.
+template <typename T, typename Protocol = asio::ip::tcp>
 class server_interface {
  public:
-    // Create a server, ready to listen on specified port
-    explicit server_interface(uint16_t port)
-        : m_asioAcceptor(m_asioContext,
-                         asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)) {}
+    using connection_type    = connection<T, Protocol>;
+    using owned_message_type = typename connection_type::owned_message_type;
+    using socket_type        = typename Protocol::socket;
+
+    // Create a server, ready to listen on specified port. The socket options
+    // policy is applied to every accepted connection, and connections are
+    // spread over nIoThreads io threads.
+    explicit server_interface(uint16_t port,
+                              const socket_options& options = socket_options(),
+                              size_t nIoThreads = 1)
+        : server_interface(
+              typename Protocol::endpoint(asio::ip::tcp::v4(), port), options,
+              nIoThreads) {}
+
+    // Create a server listening on any endpoint of the protocol, e.g. a
+    // asio::local::stream_protocol::endpoint (socket file path). A stale
+    // socket file left by an earlier run is removed first, and the socket
+    // file is removed again by Stop().
+    explicit server_interface(const typename Protocol::endpoint& endpoint,
+                              const socket_options& options = socket_options(),
+                              size_t nIoThreads = 1)
+        : m_asioAcceptor(m_asioContext), m_socketOptions(options) {
+        // Accepted sockets inherit the buffer sizes, which must be in place
+        // before the handshake to raise the TCP window scale
+        const auto& local = RemoveStaleSocketFile(endpoint);
+        m_asioAcceptor.open(local.protocol());
+        m_asioAcceptor.set_option(asio::socket_base::reuse_address(true));
+        m_socketOptions.apply_buffers(m_asioAcceptor);
+        m_asioAcceptor.bind(local);
+        m_asioAcceptor.listen();
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+        if constexpr (std::is_same_v<Protocol, asio::local::stream_protocol>) {
+            m_sSocketFile = endpoint.path();
+        }
+#endif
+        m_vecShards.push_back(std::make_unique<io_shard>(m_asioContext));
+        for (size_t i = 1; i < nIoThreads; i++) {
+            m_vecIoContexts.push_back(std::make_unique<asio::io_context>());
+            m_vecShards.push_back(
+                std::make_unique<io_shard>(*m_vecIoContexts.back()));
+        }
+    }
 
+    // A derived server must call Stop() in its own destructor. The io
+    // threads and the handler pool call its virtual functions, and by the
+    // time this destructor runs the derived part is already gone.
     virtual ~server_interface() {
+        assert(!m_bRunning && "derived servers must call Stop() first");
+
         // May as well try and tidy up
         Stop();
+
+        // Connections must go before the io contexts their sockets live on,
+        // including the ones held by messages nobody has handled
+        m_qMessagesIn.clear();
+        m_connections.clear();
+        m_topics.clear();
+        m_vecShards.clear();
     }
 
     // Starts the server!
@@ -43,71 +129,274 @@ class server_interface {
             // connect.
             WaitForClientConnection();
 
+#if defined(OLC_NET_HAS_CAPTURE)
+            // Records of a connection that went quiet would otherwise wait in
+            // its thread's buffer until Stop()
+            if (m_capture) {
+                m_timerCapture.emplace(m_asioContext);
+                FlushCapture();
+            }
+#endif
+
+            // The UDP side channel listens on the same port number
+            if constexpr (std::is_same_v<Protocol, asio::ip::tcp>) {
+                if (m_nUdpMtu > 0) {
+                    m_udpSocket.emplace(
+                        m_asioContext,
+                        asio::ip::udp::endpoint(
+                            m_asioAcceptor.local_endpoint().address(),
+                            m_asioAcceptor.local_endpoint().port()));
+                    ReadDatagram();
+                }
+            }
+
             // Launch the asio context in its own thread
             // Stop the context, WaitForClientConnection에서 context가 종료되지
             // 않도록 별도의 작업을 시켜야 한다? 그래야만 context.run()이 바로
             // 종료되지 않는다.
-            m_threadContext = std::thread([this]() { m_asioContext.run(); });
+            // Thread i runs shard i, so shard i stays on the i-th placement cpu
+            m_ioThreads =
+                std::make_unique<iothreads::io_thread_pool>(m_ioPlacement);
+            m_ioThreads->spawn([this]() { m_asioContext.run(); });
+
+            // The other shards have no work of their own until a client is
+            // placed on them, so keep their contexts from returning early
+            for (auto& context : m_vecIoContexts) {
+                m_vecWorkGuards.push_back(
+                    asio::make_work_guard(context->get_executor()));
+                m_ioThreads->spawn([&context]() { context->run(); });
+            }
         } catch (std::exception& e) {
             // Something prohibited the server from listening
-            std::cerr << "[SERVER] Exception: " << e.what() << "\n";
+            alog::error("[SERVER] Exception: ", e.what());
             return false;
         }
 
-        std::cout << "[SERVER] Started!\n";
+        m_bRunning = true;
+        alog::info("[SERVER] Started!");
         return true;
     }
 
-    // Stops the server!
+    // Pin the io threads (one per shard, shard i on cpus[i % size]) and name
+    // them. Connections, their buffers and queues are allocated on the io
+    // thread of their shard, so they end up on its NUMA node. Call it before
+    // Start().
+    void SetIoPlacement(const iothreads::placement& placement) {
+        m_ioPlacement = placement;
+    }
+
+    // Receive limits for every client accepted from now on. Each connection
+    // keeps its own buckets, so there is no shared state on the receive path.
+    // Call it before Start().
+    void SetRateLimit(const rate_limit_policy& policy) {
+        m_rateLimit = policy;
+    }
+
+    // Run OnMessage on a pool of nThreads workers instead of the thread that
+    // calls Update(). Messages of one client are still handled one at a time
+    // and in order, different clients are handled in parallel, so OnMessage
+    // must be thread safe across clients. Call it before Start().
+    void EnableHandlerPool(
+        size_t nThreads = std::thread::hardware_concurrency()) {
+        m_handlerPool = std::make_unique<worker_pool>(nThreads);
+    }
+
+    // Accept UDP side channels from clients that enabled theirs, on the same
+    // port number as the TCP listener. Messages sent with
+    // MessageClientUnreliable() are split into datagrams of at most nMtu
+    // payload bytes. Call it before Start().
+    void EnableUnreliableChannel(size_t nMtu = 1200) {
+        static_assert(std::is_same_v<Protocol, asio::ip::tcp>,
+                      "The UDP side channel needs a TCP server");
+        m_nUdpMtu = nMtu;
+    }
+
+#if defined(OLC_NET_HAS_CAPTURE)
+    // Record every message the clients send, as it is queued for Update(),
+    // to an append-only log at path (see net_capture.h). The log is complete
+    // once the server has stopped. Call it before Start().
+    bool EnableCapture(const std::string& path) {
+        m_capture = std::make_unique<capture_writer>();
+        if (!m_capture->open(path)) {
+            alog::error("[SERVER] Cannot open capture ", path);
+            m_capture.reset();
+            return false;
+        }
+        return true;
+    }
+
+    // Feed a capture back in, as if its clients had sent it again, and return
+    // the number of messages queued. Messages are queued in time order with
+    // their original spacing divided by fSpeed (0 = as fast as possible), so
+    // Update() must run meanwhile on another thread. Each recorded client is
+    // played by a connection without a socket that has its ID, anything sent
+    // to it is dropped. OnClientConnect is not called for them. Returns early
+    // once Stop() has been called.
+    size_t Replay(const std::string& path, double fSpeed = 1.0) {
+        capture_reader reader;
+        if (!reader.open(path)) {
+            alog::error("[SERVER] Cannot read capture ", path);
+            return 0;
+        }
+        std::vector<capture_record> vecRecords;
+        capture_record record;
+        while (reader.next(record)) {
+            vecRecords.push_back(std::move(record));
+        }
+        // Each io thread wrote its own batches, restore the arrival order
+        std::stable_sort(vecRecords.begin(), vecRecords.end(),
+                         [](const capture_record& a, const capture_record& b) {
+                             return a.time_ns < b.time_ns;
+                         });
+
+        std::unordered_map<uint32_t, std::shared_ptr<connection_type>>
+            mapClients;
+        auto tpStart = std::chrono::steady_clock::now();
+        size_t nQueued = 0;
+        for (auto& rec : vecRecords) {
+            auto& client = mapClients[rec.client_id];
+            if (!client) {
+                client = std::make_shared<connection_type>(
+                    connection_type::owner::server, m_asioContext,
+                    socket_type(m_asioContext), m_qMessagesIn);
+                client->ConnectToClient(rec.client_id);
+            }
+            if (fSpeed > 0.0) {
+                // In short steps, so that Stop() is noticed during long gaps
+                auto tpDue =
+                    tpStart + std::chrono::nanoseconds(static_cast<int64_t>(
+                                  rec.time_ns / fSpeed));
+                while (m_bRunning && std::chrono::steady_clock::now() < tpDue) {
+                    std::this_thread::sleep_until(
+                        std::min(tpDue, std::chrono::steady_clock::now() +
+                                            std::chrono::milliseconds(50)));
+                }
+            }
+            if (!m_bRunning) {
+                break;
+            }
+            m_qMessagesIn.push_back({client, rec.to_message<T>()});
+            nQueued++;
+        }
+        return nQueued;
+    }
+#endif
+
+    // Stops the server! Once it returns no more handlers (OnMessage etc.) run.
+    // Call it from the destructor of the derived server at the latest.
     void Stop() {
         // Request the context to close
         m_asioContext.stop();
+        for (auto& context : m_vecIoContexts) {
+            context->stop();
+        }
 
-        // Tidy up the context thread
+        // Tidy up the context threads
         // context에서 처리하기 에 따라 바로 join이 불가능한 경우가 있다.
         // 따라서 joinable인지 판단하고 join가능할 때 join을 수행한다. (루프로
         // 체크할 필요는 없나?)
-        if (m_threadContext.joinable()) {
-            m_threadContext.join();
+        if (m_ioThreads) {
+            m_ioThreads->join();
+        }
+        m_vecWorkGuards.clear();
+
+#if defined(OLC_NET_HAS_CAPTURE)
+        // Nobody records any more, flush what the io threads still hold
+        m_timerCapture.reset();
+        if (m_capture) {
+            m_capture->close();
         }
+#endif
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+        // Nobody accepts any more, don't leave the socket file behind
+        if (!m_sSocketFile.empty()) {
+            asio::error_code ignored;
+            m_asioAcceptor.close(ignored);
+            RemoveSocketFile(m_sSocketFile);
+            m_sSocketFile.clear();
+        }
+#endif
+
+        // Handlers that are still queued are dropped, the ones running are
+        // waited for
+        m_mapClientQueues.clear();
+        m_handlerPool.reset();
 
-        // Inform someone, anybody, if they care...
-        std::cout << "[SERVER] Stopped!\n";
+        if (m_bRunning) {
+            m_bRunning = false;
+            // Inform someone, anybody, if they care...
+            alog::info("[SERVER] Stopped!");
+        }
     }
 
     // ASYNC - Instruct asio to wait for connection
     void WaitForClientConnection() {
         // Prime context with an instruction to wait until a socket connects.
         // This is the purpose of an "acceptor" object. It will provide a unique
-        // socket for each incoming connection attempt
-        m_asioAcceptor.async_accept([this](std::error_code ec,
-                                           asio::ip::tcp::socket socket) {
+        // socket for each incoming connection attempt. The socket is created
+        // on the io context of the shard the client will live on.
+        io_shard& shard = *m_vecShards[m_nNextShard];
+        m_nNextShard    = (m_nNextShard + 1) % m_vecShards.size();
+
+        m_asioAcceptor.async_accept(shard.context, [this, &shard](
+                                                       std::error_code ec,
+                                                       socket_type socket) {
             // Triggered by incoming connection request
+            TRACE_SCOPE("accept");
             if (!ec) {
                 // Display some useful(?) information
-                std::cout << "[SERVER] New Connection: "
-                          << socket.remote_endpoint() << "\n";
+                alog::info("[SERVER] New Connection: ",
+                           socket.remote_endpoint());
 
                 // Create a new connection to handle this client
-                std::shared_ptr<connection<T>> newconn =
-                    std::make_shared<connection<T>>(
-                        connection<T>::owner::server, m_asioContext,
+                std::shared_ptr<connection_type> newconn =
+                    std::make_shared<connection_type>(
+                        connection_type::owner::server, shard.context,
                         std::move(socket), m_qMessagesIn);
-
-                // Give the user server a chance to deny connection
+                newconn->SetSocketOptions(m_socketOptions);
+                newconn->SetRateLimit(m_rateLimit);
+                // A connection that dies is removed right away, not only when
+                // a send to it fails
+                newconn->SetDisconnectHandler(
+                    [this, weak = std::weak_ptr<connection_type>(newconn)]() {
+                        if (auto client = weak.lock()) {
+                            RemoveClient(client);
+                        }
+                    });
+#if defined(OLC_NET_HAS_CAPTURE)
+                newconn->SetCapture(m_capture.get());
+#endif
+
+                // Give the user server a chance to deny connection. If it is
+                // allowed, register it. The registry hands out the ID, which is
+                // never reused for another client.
+                uint32_t nID = 0;
                 if (OnClientConnect(newconn)) {
-                    // Connection allowed, so add to container of new
-                    // connections
-                    m_deqConnections.push_back(std::move(newconn));
+                    std::scoped_lock lock(m_muxConnections);
+                    nID = m_connections.insert(newconn);
+                }
 
-                    // And very important! Issue a task to the connection's
-                    // asio context to sit and wait for bytes to arrive!
-                    m_deqConnections.back()->ConnectToClient(nIDCounter++);
+                if (nID != 0) {
+                    if (m_nUdpMtu > 0) {
+                        RegisterUdpToken(newconn);
+                    }
 
-                    std::cout << "[" << m_deqConnections.back()->GetID()
-                              << "] Connection Approved\n";
+                    // And very important! Issue a task to the connection's
+                    // asio context to sit and wait for bytes to arrive, and
+                    // hand it to its shard so broadcasts reach it. Both on
+                    // the shard's thread, the socket is not thread safe.
+                    asio::post(shard.context, [this, &shard, newconn, nID]() {
+                        newconn->ConnectToClient(nID);
+                        shard.connections.push_back(newconn);
+                        if (m_nUdpMtu > 0) {
+                            SendUdpToken(newconn);
+                        }
+                    });
+
+                    alog::info("[", nID, "] Connection Approved");
                 } else {
-                    std::cout << "[-----] Connection Denied\n";
+                    alog::info("[-----] Connection Denied");
 
                     // Connection will go out of scope with no pending tasks, so
                     // will get destroyed automagically due to the wonder of
@@ -115,8 +404,7 @@ class server_interface {
                 }
             } else {
                 // Error has occurred during acceptance
-                std::cout << "[SERVER] New Connection Error: " << ec.message()
-                          << "\n";
+                alog::warn("[SERVER] New Connection Error: ", ec.message());
             }
 
             // Prime the asio context with more work - again simply wait for
@@ -126,64 +414,131 @@ class server_interface {
     }
 
     // Send a message to a specific client
-    void MessageClient(std::shared_ptr<connection<T>> client,
+    void MessageClient(std::shared_ptr<connection_type> client,
                        const message<T>& msg) {
         // Check client is legitimate...
         if (client && client->IsConnected()) {
             // ...and post the message via the connection
             client->Send(msg);
-        } else {
+        } else if (client) {
             // If we cant communicate with client then we may as
             // well remove the client - let the server know, it may
             // be tracking it somehow
-            OnClientDisconnect(client);
+            RemoveClient(client);
+        }
+    }
 
-            // Off you go now, bye bye!
-            client.reset();
+    // Send a message over the client's UDP side channel, see
+    // connection::SendUnreliable(). OnMessage sees it like any other message.
+    void MessageClientUnreliable(std::shared_ptr<connection_type> client,
+                                 const message<T>& msg) {
+        if (client && client->IsConnected()) {
+            client->SendUnreliable(msg);
+        } else if (client) {
+            RemoveClient(client);
+        }
+    }
 
-            // Then physically remove it from the container
-            m_deqConnections.erase(std::remove(m_deqConnections.begin(),
-                                               m_deqConnections.end(), client),
-                                   m_deqConnections.end());
+    // Send a message to the client with the given ID, returns false if there
+    // is no such (connected) client
+    bool MessageClient(uint32_t nClientID, const message<T>& msg) {
+        std::shared_ptr<connection_type> client = GetClient(nClientID);
+        if (!client) {
+            return false;
         }
+        MessageClient(client, msg);
+        return client->IsConnected();
     }
 
-    // Send message to all clients
+    // O(1) lookup of a registered client, nullptr if it has gone
+    std::shared_ptr<connection_type> GetClient(uint32_t nClientID) {
+        std::scoped_lock lock(m_muxConnections);
+        std::shared_ptr<connection_type>* client = m_connections.find(nClientID);
+        return client ? *client : nullptr;
+    }
+
+    // Send message to all clients. The message is copied once, then each io
+    // thread queues it to its own clients. Clients found dead on the way are
+    // removed on their io thread, so OnClientDisconnect may be called there.
     void MessageAllClients(
         const message<T>& msg,
-        std::shared_ptr<connection<T>> pIgnoreClient = nullptr) {
-        bool bInvalidClientExists = false;
+        std::shared_ptr<connection_type> pIgnoreClient = nullptr) {
+        auto frame = std::make_shared<const message<T>>(msg);
+        for (auto& shard : m_vecShards) {
+            asio::post(shard->context, [this, s = shard.get(), frame,
+                                        pIgnoreClient]() {
+                BroadcastOnShard(*s, frame, pIgnoreClient);
+            });
+        }
+    }
 
-        // Iterate through all clients in container
-        for (auto& client : m_deqConnections) {
-            // Check client is connected...
-            if (client && client->IsConnected()) {
-                // ..it is!
-                if (client != pIgnoreClient) {
-                    client->Send(msg);
+    // Subscribe a client to a topic, returns false if it already is or if it
+    // is no longer connected to the server
+    bool Subscribe(const std::shared_ptr<connection_type>& client,
+                   const std::string& topic) {
+        std::scoped_lock lock(m_muxTopics);
+        // RemoveClient unsubscribes after taking the client out of the
+        // registry, so checking under the topic lock cannot miss it
+        {
+            std::scoped_lock lockConnections(m_muxConnections);
+            const auto* registered = m_connections.find(client->GetID());
+            if (!registered || *registered != client) {
+                return false;
+            }
+        }
+        return m_topics.subscribe(topic, client);
+    }
+
+    // Returns false if the client was not subscribed to the topic
+    bool Unsubscribe(const std::shared_ptr<connection_type>& client,
+                     const std::string& topic) {
+        std::scoped_lock lock(m_muxTopics);
+        return m_topics.unsubscribe(topic, client->GetID());
+    }
+
+    // Send a message to every subscriber of a topic and return how many it was
+    // sent to. The cost depends on the number of subscribers only, the message
+    // is copied once and shared by all of them.
+    size_t Publish(const std::string& topic, const message<T>& msg,
+                   std::shared_ptr<connection_type> pIgnoreClient = nullptr) {
+        std::shared_ptr<const message<T>> frame;
+        std::vector<std::shared_ptr<connection_type>> vecDeadClients;
+        size_t nSent = 0;
+        {
+            std::scoped_lock lock(m_muxTopics);
+            const auto* subscribers = m_topics.subscribers(topic);
+            if (!subscribers) {
+                return 0;
+            }
+            frame = std::make_shared<const message<T>>(msg);
+            for (const auto& client : *subscribers) {
+                if (client->IsConnected()) {
+                    if (client != pIgnoreClient) {
+                        client->Send(frame);
+                        nSent++;
+                    }
+                } else {
+                    vecDeadClients.push_back(client);
                 }
-            } else {
-                // The client couldnt be contacted, so assume it has
-                // disconnected.
-                OnClientDisconnect(client);
-                client.reset();
+            }
 
-                // Set this flag to then remove dead clients from container
-                bInvalidClientExists = true;
+            // Whoever removes them from the registry also does this, but
+            // they must not linger on the topic if that has happened already
+            for (auto& client : vecDeadClients) {
+                m_topics.unsubscribe_all(client->GetID());
             }
         }
 
-        // Remove dead clients, all in one go - this way, we dont invalidate the
-        // container as we iterated through it.
-        // m_deqConnection을 iteration 중간에 변경하지 않고 다 끝나고 flag가
-        // 참인 경우만 변경한다.
-        if (bInvalidClientExists) {
-            m_deqConnections.erase(std::remove(m_deqConnections.begin(),
-                                               m_deqConnections.end(), nullptr),
-                                   m_deqConnections.end());
+        for (auto& client : vecDeadClients) {
+            RemoveClient(client);
         }
+        return nSent;
     }
 
+    // Make an Update() that waits for messages return, e.g. to shut down.
+    // Safe to call from any thread.
+    void Wake() { m_qMessagesIn.wake(); }
+
     // Force server to respond to incoming messages
     //* 단일 큐에서 클라이언트에서 들어오는 메세지를 처리하는 함수
     void Update(size_t nMaxMessages = -1, bool bWait = false) {
@@ -197,9 +552,18 @@ class server_interface {
         while (nMessageCount < nMaxMessages && !m_qMessagesIn.empty()) {
             // Grab the front message
             auto msg = m_qMessagesIn.pop_front();
-
-            // Pass to message handler
-            OnMessage(msg.remote, msg.msg);
+#if defined(ENABLE_TRACE)
+            TRACE_SINCE("queue wait", msg.trace_queued_ns);
+#endif
+
+            // Pass to message handler, or to the client's serial queue on the
+            // handler pool
+            if (m_handlerPool) {
+                DispatchToPool(std::move(msg));
+            } else {
+                TRACE_SCOPE("OnMessage");
+                OnMessage(msg.remote, msg.msg);
+            }
 
             nMessageCount++;
         }
@@ -209,36 +573,316 @@ class server_interface {
     // This server class should override thse functions to implement
     // customised functionality
 
+    // Removal of a dead client, OnClientDisconnect is called (outside of
+    // the registry lock) only by whoever actually removed it. The client is
+    // also taken off every topic it subscribed to.
+    void RemoveClient(const std::shared_ptr<connection_type>& client) {
+        bool bRemoved;
+        {
+            std::scoped_lock lock(m_muxConnections);
+            bRemoved = m_connections.erase(client->GetID());
+        }
+        if (bRemoved) {
+            {
+                std::scoped_lock lock(m_muxTopics);
+                m_topics.unsubscribe_all(client->GetID());
+            }
+            if (m_nUdpMtu > 0) {
+                std::scoped_lock lock(m_muxUdpClients);
+                m_mapUdpClients.erase(client->GetUdpToken());
+            }
+
+            // Let go of it on its shard as well
+            for (auto& shard : m_vecShards) {
+                if (&shard->context == &client->GetContext()) {
+                    asio::post(shard->context, [s = shard.get(), client]() {
+                        auto& clients = s->connections;
+                        auto it =
+                            std::find(clients.begin(), clients.end(), client);
+                        if (it != clients.end()) {
+                            *it = std::move(clients.back());
+                            clients.pop_back();
+                        }
+                    });
+                }
+            }
+            OnClientDisconnect(client);
+        }
+    }
+
+    // A group of clients that share one io thread
+    struct io_shard {
+        explicit io_shard(asio::io_context& ctx) : context(ctx) {}
+
+        asio::io_context& context;
+
+        // Only touched on the shard's own io thread
+        std::vector<std::shared_ptr<connection_type>> connections;
+    };
+
+    // ASIO THREAD (of the shard)
+    void BroadcastOnShard(io_shard& shard,
+                          const std::shared_ptr<const message<T>>& frame,
+                          const std::shared_ptr<connection_type>& pIgnoreClient) {
+        auto& clients = shard.connections;
+        for (size_t i = 0; i < clients.size();) {
+            // Check client is connected...
+            if (clients[i]->IsConnected()) {
+                // ..it is! We are on its io thread, so this queues the frame
+                // right away
+                if (clients[i] != pIgnoreClient) {
+                    clients[i]->Send(frame);
+                }
+                i++;
+            } else {
+                // The client couldnt be contacted, so assume it has
+                // disconnected. Swap it out of the shard and remove it.
+                std::shared_ptr<connection_type> client = std::move(clients[i]);
+                clients[i] = std::move(clients.back());
+                clients.pop_back();
+                RemoveClient(client);
+            }
+        }
+    }
+
+    // UPDATE THREAD - queue the message behind the earlier ones of its client
+    void DispatchToPool(owned_message_type msg) {
+        uint32_t nID = msg.remote->GetID();
+        auto& queue  = m_mapClientQueues[nID];
+        if (!queue) {
+            queue = std::make_shared<serial_queue<owned_message_type>>(
+                *m_handlerPool, [this](owned_message_type& m) {
+                    TRACE_SCOPE("OnMessage");
+                    OnMessage(m.remote, m.msg);
+                });
+        }
+        queue->push(std::move(msg));
+
+        // Now and then forget the queues of clients that have gone, once
+        // they have nothing left to run
+        if (++m_nDispatched % 1024 == 0) {
+            for (auto it = m_mapClientQueues.begin();
+                 it != m_mapClientQueues.end();) {
+                if (!GetClient(it->first) && it->second->idle()) {
+                    it = m_mapClientQueues.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+#if defined(OLC_NET_HAS_CAPTURE)
+    // ASIO THREAD - Commit the capture buffers every FLUSH_INTERVAL
+    void FlushCapture() {
+        m_timerCapture->expires_after(capture_writer::FLUSH_INTERVAL);
+        m_timerCapture->async_wait([this](std::error_code ec) {
+            if (!ec) {
+                m_capture->flush();
+                FlushCapture();
+            }
+        });
+    }
+#endif
+
+    // ASIO THREAD - Negotiation and data of the UDP side channels
+    void ReadDatagram() {
+        m_udpSocket->async_receive_from(
+            asio::buffer(m_udpBuffer), m_udpSender,
+            [this](asio::error_code ec, std::size_t length) {
+                if (ec == asio::error::operation_aborted) {
+                    return;
+                }
+                udp_packet_header packet;
+                if (!ec &&
+                    udp_packet_header::parse(m_udpBuffer.data(), length,
+                                             packet)) {
+                    if (packet.kind == udp_packet_header::hello) {
+                        AttachUdpChannel(packet.token);
+                    } else if (packet.kind == udp_packet_header::data) {
+                        DeliverDatagram(packet, length);
+                    }
+                }
+                ReadDatagram();
+            });
+    }
+
+    // ACCEPTOR THREAD - A token nobody can guess, so only the client that
+    // got it over TCP can attach a side channel to the connection
+    void RegisterUdpToken(const std::shared_ptr<connection_type>& client) {
+        std::scoped_lock lock(m_muxUdpClients);
+        uint64_t nToken;
+        do {
+            nToken = (uint64_t(m_udpTokenSource()) << 32) | m_udpTokenSource();
+        } while (nToken == 0 || m_mapUdpClients.count(nToken) > 0);
+        client->SetUdpToken(nToken);
+        m_mapUdpClients.emplace(nToken, client);
+    }
+
+    // ASIO THREAD (of the shard)
+    static void SendUdpToken(const std::shared_ptr<connection_type>& client) {
+        message<T> msg;
+        msg.header.correlation_id = UDP_TOKEN_CORRELATION_ID;
+        msg << client->GetUdpToken();
+        client->Send(msg);
+    }
+
+    // The live connection that was handed nToken, if any
+    std::shared_ptr<connection_type> FindUdpClient(uint64_t nToken) {
+        std::scoped_lock lock(m_muxUdpClients);
+        auto it = m_mapUdpClients.find(nToken);
+        if (it == m_mapUdpClients.end()) {
+            return nullptr;
+        }
+        std::shared_ptr<connection_type> client = it->second.lock();
+        return client && client->IsConnected() ? client : nullptr;
+    }
+
+    // ASIO THREAD - hello from m_udpSender. A repeated hello (our welcome got
+    // lost) is answered again. The token is the only proof of who sent it, so
+    // a client whose address changed (e.g. a NAT rebinding) moves its channel
+    // with it.
+    void AttachUdpChannel(uint64_t nToken) {
+        std::shared_ptr<connection_type> client = FindUdpClient(nToken);
+        if (!client) {
+            return;
+        }
+
+        std::shared_ptr<udp_channel<T>> channel = client->GetUdpChannel();
+        if (!channel || channel->remote() != m_udpSender) {
+            channel = std::make_shared<udp_channel<T>>(
+                *m_udpSocket, m_udpSender, m_nUdpMtu, nToken);
+            client->SetUdpChannel(channel);
+        }
+        channel->send_control(udp_packet_header::welcome);
+    }
+
+    // ASIO THREAD - Data is only taken from the address the channel is
+    // attached to, and only with its token
+    void DeliverDatagram(const udp_packet_header& packet, size_t length) {
+        std::shared_ptr<connection_type> client = FindUdpClient(packet.token);
+        std::shared_ptr<udp_channel<T>> channel =
+            client ? client->GetUdpChannel() : nullptr;
+        if (!channel || channel->remote() != m_udpSender) {
+            return;
+        }
+
+        std::optional<message<T>> msg =
+            channel->receive(packet, m_udpBuffer.data() + sizeof(packet),
+                             length - sizeof(packet));
+        if (msg) {
+            client->DeliverUnreliable(std::move(*msg));
+        }
+    }
+
+    static const typename Protocol::endpoint& RemoveStaleSocketFile(
+        const typename Protocol::endpoint& endpoint) {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+        if constexpr (std::is_same_v<Protocol, asio::local::stream_protocol>) {
+            RemoveSocketFile(endpoint.path());
+        }
+#endif
+        return endpoint;
+    }
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    // Only a socket is removed, a regular file (e.g. a misconfigured path)
+    // is left alone and bind then fails
+    static void RemoveSocketFile(const std::string& path) {
+        struct stat st;
+        if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            ::unlink(path.c_str());
+        }
+    }
+#endif
+
     // Called when a client connects, you can veto the connection by returning
     // false
-    virtual bool OnClientConnect(std::shared_ptr<connection<T>> client) {
+    virtual bool OnClientConnect(std::shared_ptr<connection_type> client) {
         return false;
     }
 
-    // Called when a client appears to have disconnected
-    virtual void OnClientDisconnect(std::shared_ptr<connection<T>> client) {}
+    // Called when a client appears to have disconnected. A connection that
+    // fails reports it from its io thread, otherwise it is called on the
+    // thread that found the client dead.
+    virtual void OnClientDisconnect(std::shared_ptr<connection_type> client) {}
 
     // Called when a message arrives
-    virtual void OnMessage(std::shared_ptr<connection<T>> client,
+    virtual void OnMessage(std::shared_ptr<connection_type> client,
                            message<T>& msg) {}
 
     // Thread Safe Queue for incoming message packets
-    tsqueue<owned_message<T>> m_qMessagesIn;
+    tsqueue<owned_message_type> m_qMessagesIn;
 
-    // Container of active validated connections
-    std::deque<std::shared_ptr<connection<T>>> m_deqConnections;
+    // Container of active validated connections, keyed by client ID.
+    // Accepts (asio thread), broadcasts (io threads) and messaging (Update
+    // thread) all touch it.
+    slot_map<std::shared_ptr<connection_type>> m_connections;
+    std::mutex m_muxConnections;
+
+    // Inverted index topic -> subscribed clients, see Publish(). Taken before
+    // m_muxConnections when both are needed.
+    topic_index<std::shared_ptr<connection_type>> m_topics;
+    std::mutex m_muxTopics;
 
     // Order of declaration is important - it is also the order of
     // initialisation
     asio::io_context m_asioContext;
-    std::thread m_threadContext;
+
+    // Extra io contexts, shard 0 runs on m_asioContext. Thread i of
+    // m_ioThreads runs shard i.
+    std::vector<std::unique_ptr<asio::io_context>> m_vecIoContexts;
+    std::vector<asio::executor_work_guard<asio::io_context::executor_type>>
+        m_vecWorkGuards;
+    iothreads::placement m_ioPlacement{{}, "olc-io"};
+    std::unique_ptr<iothreads::io_thread_pool> m_ioThreads;
+    std::vector<std::unique_ptr<io_shard>> m_vecShards;
+    size_t m_nNextShard = 0;  // acceptor thread only
 
     // These things need an asio context
-    asio::ip::tcp::acceptor
+    typename Protocol::acceptor
         m_asioAcceptor;  // Handles new incoming connection attempts...
 
-    // Clients will be identified in the "wider system" via an ID
-    uint32_t nIDCounter = 10000;
+    // UDP side channels, see EnableUnreliableChannel(). The socket is only
+    // used on the asio thread of m_asioContext.
+    size_t m_nUdpMtu = 0;
+    std::optional<asio::ip::udp::socket> m_udpSocket;
+    asio::ip::udp::endpoint m_udpSender;
+    std::array<uint8_t, 65536> m_udpBuffer;
+    // Token -> connection, filled by the acceptor (any shard thread)
+    std::mutex m_muxUdpClients;
+    std::unordered_map<uint64_t, std::weak_ptr<connection_type>>
+        m_mapUdpClients;
+    std::random_device m_udpTokenSource;
+
+    // Socket options applied to every accepted socket
+    socket_options m_socketOptions;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    // Path of the listening Unix domain socket, removed by Stop()
+    std::string m_sSocketFile;
+#endif
+
+    // Receive limits given to every accepted connection
+    rate_limit_policy m_rateLimit;
+
+#if defined(OLC_NET_HAS_CAPTURE)
+    // See EnableCapture(), shared by all connections
+    std::unique_ptr<capture_writer> m_capture;
+    std::optional<asio::steady_timer> m_timerCapture;
+#endif
+
+    // Optional OnMessage pool, see EnableHandlerPool(). The serial queue of
+    // each client is only looked up on the Update thread.
+    std::unique_ptr<worker_pool> m_handlerPool;
+
+    // Between a successful Start() and Stop(). Set by the owner thread, read
+    // by Replay() as well.
+    std::atomic<bool> m_bRunning{false};
+    std::unordered_map<uint32_t,
+                       std::shared_ptr<serial_queue<owned_message_type>>>
+        m_mapClientQueues;
+    size_t m_nDispatched = 0;
 };
 
 }  // namespace olc::net
\ No newline at end of file
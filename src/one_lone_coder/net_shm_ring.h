@@ -0,0 +1,341 @@
+/**
+ * @file net_shm_ring.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 공유 메모리 위의 SPSC 바이트 링과 futex 기반 대기/깨우기
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace olc::net {
+
+// Atomics in shared memory must not fall back to a (process local) lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+// Futex on a 32 bit word that may live in another process' mapping as well
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected,
+                       std::chrono::microseconds timeout) {
+    timespec ts{};
+    ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected,
+            &ts, nullptr, 0);
+}
+
+inline void futex_wake_all(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE,
+            INT32_MAX, nullptr, nullptr, 0);
+}
+
+// False once the process is gone. An unknown pid (0) counts as alive, and a
+// recycled pid is mistaken for the peer, which only delays the cleanup.
+inline bool process_alive(uint32_t pid) {
+    return pid == 0 || ::kill(static_cast<pid_t>(pid), 0) == 0 ||
+           errno == EPERM;
+}
+
+//* 한 방향의 링 버퍼 (single producer, single consumer). head는 producer만,
+//* tail은 consumer만 쓰므로 잠금이 필요 없다. 두 값은 계속 증가하는 바이트
+//* 위치이고 (capacity로 나눈 나머지가 실제 위치), 서로 다른 캐시 라인에 둬서
+//* false sharing을 피한다.
+//*
+//* consumer가 잠들기 전에 sleeping을 세우고 seq를 읽은 뒤 한번 더 데이터를
+//* 확인한다. producer는 head를 올린 다음 seq를 올리고 sleeping을 확인한다.
+//* 두 쪽 모두 seq_cst이므로 깨우기를 잃어버리지 않는다. 링이 가득 찬 producer는
+//* 반대 방향으로 같은 방법 (space_seq, writer_sleeping)을 써서 consumer가 비워
+//* 줄 때까지 잠든다.
+struct shm_ring_header {
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) std::atomic<uint32_t> seq{0};
+    std::atomic<uint32_t> sleeping{0};
+    alignas(64) std::atomic<uint32_t> space_seq{0};
+    std::atomic<uint32_t> writer_sleeping{0};
+};
+
+class shm_ring {
+ public:
+    shm_ring() = default;
+    shm_ring(shm_ring_header* header, uint8_t* data, size_t capacity)
+        : m_header(header), m_data(data), m_capacity(capacity) {}
+
+    size_t capacity() const { return m_capacity; }
+
+    size_t free_bytes() const {
+        return m_capacity - (m_header->head.load(std::memory_order_relaxed) -
+                             m_header->tail.load(std::memory_order_acquire));
+    }
+
+    size_t used_bytes() const {
+        return m_header->head.load(std::memory_order_acquire) -
+               m_header->tail.load(std::memory_order_relaxed);
+    }
+
+    // PRODUCER - append the pieces as one record, false if there is no room
+    bool try_write(const void* a, size_t nA, const void* b, size_t nB) {
+        if (free_bytes() < nA + nB) {
+            return false;
+        }
+        uint64_t head = m_header->head.load(std::memory_order_relaxed);
+        CopyIn(head, a, nA);
+        CopyIn(head + nA, b, nB);
+        m_header->head.store(head + nA + nB, std::memory_order_release);
+        return true;
+    }
+
+    // PRODUCER - wake the consumer if it went to sleep
+    void notify() {
+        m_header->seq.fetch_add(1, std::memory_order_seq_cst);
+        if (m_header->sleeping.load(std::memory_order_seq_cst)) {
+            futex_wake_all(m_header->seq);
+        }
+    }
+
+    // PRODUCER - block until n bytes are free or the timeout passes
+    void wait_for_space(size_t n, std::chrono::microseconds timeout) {
+        m_header->writer_sleeping.store(1, std::memory_order_seq_cst);
+        uint32_t seq = m_header->space_seq.load(std::memory_order_seq_cst);
+        if (free_bytes() < n) {
+            futex_wait(m_header->space_seq, seq, timeout);
+        }
+        m_header->writer_sleeping.store(0, std::memory_order_relaxed);
+    }
+
+    // Either side - wake both ends regardless, e.g. to see a state change
+    void wake() {
+        m_header->seq.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake_all(m_header->seq);
+        m_header->space_seq.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake_all(m_header->space_seq);
+    }
+
+    // CONSUMER - copy n bytes at the read position without consuming them
+    void peek(void* out, size_t n, size_t offset = 0) const {
+        uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+        CopyOut(tail + offset, out, n);
+    }
+
+    // CONSUMER - free the bytes and wake a producer waiting for room
+    void consume(size_t n) {
+        m_header->tail.fetch_add(n, std::memory_order_seq_cst);
+        m_header->space_seq.fetch_add(1, std::memory_order_seq_cst);
+        if (m_header->writer_sleeping.load(std::memory_order_seq_cst)) {
+            futex_wake_all(m_header->space_seq);
+        }
+    }
+
+    // CONSUMER - block until there is data, the timeout passes or someone
+    // calls notify(). Spins a while first, since going to sleep and being
+    // woken costs two system calls.
+    void wait(uint32_t nSpin, std::chrono::microseconds timeout) {
+        for (uint32_t i = 0; i < nSpin; i++) {
+            if (used_bytes() > 0) {
+                return;
+            }
+        }
+        m_header->sleeping.store(1, std::memory_order_seq_cst);
+        uint32_t seq = m_header->seq.load(std::memory_order_seq_cst);
+        if (used_bytes() == 0) {
+            futex_wait(m_header->seq, seq, timeout);
+        }
+        m_header->sleeping.store(0, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        m_header->head.store(0, std::memory_order_relaxed);
+        m_header->tail.store(0, std::memory_order_relaxed);
+    }
+
+ private:
+    void CopyIn(uint64_t pos, const void* src, size_t n) {
+        size_t offset = pos % m_capacity;
+        size_t first  = std::min(n, m_capacity - offset);
+        std::memcpy(m_data + offset, src, first);
+        std::memcpy(m_data, static_cast<const uint8_t*>(src) + first,
+                    n - first);
+    }
+
+    void CopyOut(uint64_t pos, void* dst, size_t n) const {
+        size_t offset = pos % m_capacity;
+        size_t first  = std::min(n, m_capacity - offset);
+        std::memcpy(dst, m_data + offset, first);
+        std::memcpy(static_cast<uint8_t*>(dst) + first, m_data, n - first);
+    }
+
+    shm_ring_header* m_header = nullptr;
+    uint8_t* m_data           = nullptr;
+    size_t m_capacity         = 0;
+};
+
+//* 공유 메모리 세그먼트 하나에 제어 블록과 방향 별 링 두개를 둔다.
+//*   [control][ring header s->c][ring header c->s][data s->c][data c->s]
+//* 서버가 만들고 (create) 클라이언트가 붙는다 (open). 세그먼트 하나에는 한
+//* 번에 클라이언트 하나만 붙을 수 있다.
+class shm_segment {
+ public:
+    //* listening -> attached (클라이언트가 붙음) -> closed (어느 쪽이든 끊음)
+    //* -> released (클라이언트가 더는 링을 건드리지 않음) -> listening
+    enum state : uint32_t {
+        listening = 0,
+        attached  = 1,
+        closed    = 2,
+        released  = 3,
+    };
+
+    static constexpr uint32_t MAGIC = 0x4f4c4353;  // "OLCS"
+
+    struct control {
+        uint32_t magic;
+        uint32_t ring_bytes;
+        alignas(64) std::atomic<uint32_t> state;
+        // Process ids of both ends, 0 while a side is not there yet. A
+        // reader checks that its peer is still alive while the ring is idle.
+        std::atomic<uint32_t> server_pid;
+        std::atomic<uint32_t> client_pid;
+    };
+
+    shm_segment() = default;
+    shm_segment(const shm_segment&) = delete;
+    shm_segment& operator=(const shm_segment&) = delete;
+    ~shm_segment() { close(); }
+
+    // Server side, replaces a segment of the same name left by an earlier run
+    bool create(const std::string& name, size_t ring_bytes) {
+        m_sName   = ShmName(name);
+        m_bOwner  = true;
+        ::shm_unlink(m_sName.c_str());
+        int fd = ::shm_open(m_sName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        m_nSize = SegmentSize(ring_bytes);
+        bool ok = ::ftruncate(fd, static_cast<off_t>(m_nSize)) == 0 && Map(fd);
+        ::close(fd);
+        if (!ok) {
+            close();
+            return false;
+        }
+
+        auto* ctl       = new (m_pBase) control{};
+        ctl->ring_bytes = static_cast<uint32_t>(ring_bytes);
+        new (RingHeader(0)) shm_ring_header();
+        new (RingHeader(1)) shm_ring_header();
+        ctl->server_pid.store(static_cast<uint32_t>(::getpid()),
+                              std::memory_order_relaxed);
+        ctl->state.store(listening, std::memory_order_relaxed);
+        // Publish last, a client checks the magic before anything else
+        std::atomic_thread_fence(std::memory_order_release);
+        ctl->magic = MAGIC;
+        return true;
+    }
+
+    // Client side
+    bool open(const std::string& name) {
+        m_sName  = ShmName(name);
+        m_bOwner = false;
+        int fd   = ::shm_open(m_sName.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        bool ok = ::fstat(fd, &st) == 0 &&
+                  static_cast<size_t>(st.st_size) > sizeof(control);
+        if (ok) {
+            m_nSize = static_cast<size_t>(st.st_size);
+            ok      = Map(fd);
+        }
+        ::close(fd);
+        if (!ok || ctl()->magic != MAGIC ||
+            SegmentSize(ctl()->ring_bytes) != m_nSize) {
+            close();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    void close() {
+        if (m_pBase) {
+            ::munmap(m_pBase, m_nSize);
+            m_pBase = nullptr;
+        }
+        if (m_bOwner && !m_sName.empty()) {
+            ::shm_unlink(m_sName.c_str());
+        }
+        m_bOwner = false;
+    }
+
+    bool is_open() const { return m_pBase != nullptr; }
+
+    control* ctl() const { return static_cast<control*>(m_pBase); }
+
+    // Ring 0 carries server -> client, ring 1 client -> server
+    shm_ring ring(int direction) const {
+        size_t ring_bytes = ctl()->ring_bytes;
+        auto* data = static_cast<uint8_t*>(m_pBase) + HeaderSize() +
+                     direction * ring_bytes;
+        return shm_ring(RingHeader(direction), data, ring_bytes);
+    }
+
+ private:
+    static std::string ShmName(const std::string& name) {
+        return name.empty() || name[0] != '/' ? "/olc_" + name : name;
+    }
+
+    static size_t HeaderSize() {
+        return 64 * ((sizeof(control) + 2 * sizeof(shm_ring_header) + 63) / 64);
+    }
+
+    static size_t SegmentSize(size_t ring_bytes) {
+        return HeaderSize() + 2 * ring_bytes;
+    }
+
+    shm_ring_header* RingHeader(int direction) const {
+        auto* base = static_cast<uint8_t*>(m_pBase) + sizeof(control);
+        return reinterpret_cast<shm_ring_header*>(
+            base + direction * sizeof(shm_ring_header));
+    }
+
+    bool Map(int fd) {
+        void* p = ::mmap(nullptr, m_nSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        m_pBase = p;
+        return true;
+    }
+
+    std::string m_sName;
+    void* m_pBase = nullptr;
+    size_t m_nSize = 0;
+    bool m_bOwner = false;
+};
+
+}  // namespace olc::net
+
+#endif  // __linux__
@@ -0,0 +1,540 @@
+/**
+ * @file net_shm_transport.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 같은 호스트의 peer를 위한 공유 메모리 링 transport
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net_message.h"
+#include "net_shm_ring.h"
+#include "net_tsqueue.h"
+
+namespace olc::net {
+
+struct shm_options {
+    // Bytes per direction, a message (header + body) must fit in one ring
+    size_t ring_bytes = 1 << 20;
+
+    // Readers spin on the ring forever instead of sleeping on a futex. Lowest
+    // latency, but every connection keeps a core busy.
+    bool busy_poll = false;
+
+    // Without busy_poll, how often a reader polls before it goes to sleep
+    uint32_t spin_iterations = 4096;
+
+    // How long Send() waits for room in a full ring. A peer that has not read
+    // anything by then is disconnected, so it cannot hold the sender forever.
+    std::chrono::milliseconds send_timeout{1000};
+};
+
+// Segment name of one channel of a shm server
+inline std::string shm_channel_name(const std::string& name, size_t index) {
+    return name + "." + std::to_string(index);
+}
+
+//* 공유 메모리 세그먼트 위의 connection. 보내는 쪽은 자기 방향의 링에 헤더와
+//* 바디를 그대로 복사하고, 받는 쪽은 owner의 스레드에서 ReadLoop()를 돌며
+//* message<T>를 만들어 connection<T>와 똑같이 들어오는 큐에 넣는다. 링은
+//* 프로세스 사이에서는 SPSC이고, 한 프로세스 안의 여러 송신 스레드는
+//* m_muxOut으로 직렬화한다.
+template <typename T>
+class shm_connection : public std::enable_shared_from_this<shm_connection<T>> {
+ public:
+    enum class owner { server, client };
+
+    using owned_message_type = owned_message<T, shm_connection<T>>;
+
+    shm_connection(owner parent, shm_segment& segment,
+                   const shm_options& options,
+                   tsqueue<owned_message_type>& qIn)
+        : m_nOwnerType(parent),
+          m_control(*segment.ctl()),
+          m_ringOut(segment.ring(parent == owner::server ? 0 : 1)),
+          m_ringIn(segment.ring(parent == owner::server ? 1 : 0)),
+          m_options(options),
+          m_qMessagesIn(qIn) {}
+
+    [[nodiscard]] uint32_t GetID() const { return id; }
+
+    [[nodiscard]] bool IsConnected() const {
+        return m_control.state.load(std::memory_order_acquire) ==
+               shm_segment::attached;
+    }
+
+    // See connection::SetIncomingFilter()
+    void SetIncomingFilter(std::function<bool(message<T>&)> filter) {
+        m_incomingFilter = std::move(filter);
+    }
+
+    // Either side may close, the other side's ReadLoop() returns
+    void Disconnect() {
+        uint32_t expected = shm_segment::attached;
+        if (m_control.state.compare_exchange_strong(expected,
+                                                    shm_segment::closed)) {
+            WakeAll();
+        }
+    }
+
+    // Copies the message into the ring. Sleeps while the ring is full, so a
+    // slow reader holds the sender back instead of growing a queue, but for
+    // no longer than send_timeout.
+    void Send(const message<T>& msg) {
+        message_header<T> header = msg.header;
+        header.size = static_cast<uint32_t>(msg.body.size());
+        if (sizeof(header) + msg.body.size() > m_ringOut.capacity()) {
+            alog::warn("[", id, "] Message Too Large.");
+            return;
+        }
+
+        size_t nBytes = sizeof(header) + msg.body.size();
+        auto deadline = std::chrono::steady_clock::now() + m_options.send_timeout;
+        std::scoped_lock lock(m_muxOut);
+        while (!m_bReleased && IsConnected()) {
+            if (m_ringOut.try_write(&header, sizeof(header), msg.body.data(),
+                                    msg.body.size())) {
+                m_ringOut.notify();
+                return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                alog::warn("[", id, "] Send Timeout, Peer Not Reading.");
+                Disconnect();
+                return;
+            }
+            // Woken by the reader, or by a state change (see WakeAll())
+            m_ringOut.wait_for_space(
+                nBytes,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::min<std::chrono::steady_clock::duration>(
+                        deadline - now, LIVENESS_PERIOD)));
+        }
+    }
+
+    void Send(std::shared_ptr<const message<T>> frame) { Send(*frame); }
+
+    // OWNER THREAD - Hand incoming messages over until the connection closes.
+    // Messages already in the ring by then are still delivered. A peer that
+    // has died or sent a malformed message closes the connection.
+    void ReadLoop(uint32_t uid = 0) {
+        id = uid;
+        auto tpNextCheck = std::chrono::steady_clock::now() + LIVENESS_PERIOD;
+        for (;;) {
+            if (m_ringIn.used_bytes() >= sizeof(message_header<T>)) {
+                if (!ReadMessage()) {
+                    Disconnect();
+                    break;
+                }
+                continue;
+            }
+            if (!IsConnected()) {
+                break;
+            }
+
+            if (auto now = std::chrono::steady_clock::now();
+                now >= tpNextCheck) {
+                tpNextCheck = now + LIVENESS_PERIOD;
+                if (!PeerAlive()) {
+                    alog::warn("[", id, "] Peer Process Gone.");
+                    Disconnect();
+                    continue;
+                }
+            }
+
+            if (m_options.busy_poll) {
+                CpuRelax();
+            } else {
+                m_ringIn.wait(m_options.spin_iterations, LIVENESS_PERIOD);
+            }
+        }
+        Release();
+    }
+
+ private:
+    // Wait out a Send() in progress and refuse any further one, after this
+    // the rings may be reset for the next client
+    void Release() {
+        std::scoped_lock lock(m_muxOut);
+        m_bReleased = true;
+    }
+
+    // How often an idle reader checks that the peer process still exists
+    static constexpr std::chrono::milliseconds LIVENESS_PERIOD{100};
+
+    bool PeerAlive() const {
+        const auto& pid = m_nOwnerType == owner::server ? m_control.client_pid
+                                                        : m_control.server_pid;
+        return process_alive(pid.load(std::memory_order_acquire));
+    }
+
+    // A writer publishes header and body with one store, so a visible header
+    // means the whole message is there. The size comes from the peer, a body
+    // that is not in the ring means it is broken and the channel is dropped.
+    bool ReadMessage() {
+        message<T> msg;
+        m_ringIn.peek(&msg.header, sizeof(msg.header));
+        size_t nAvailable = m_ringIn.used_bytes() - sizeof(msg.header);
+        if (msg.header.size > nAvailable ||
+            msg.header.size > m_ringIn.capacity() - sizeof(msg.header)) {
+            alog::warn("[", id, "] Invalid Message Size ", msg.header.size);
+            return false;
+        }
+        msg.body.resize(msg.header.size);
+        m_ringIn.peek(msg.body.data(), msg.body.size(), sizeof(msg.header));
+        m_ringIn.consume(sizeof(msg.header) + msg.body.size());
+
+        if (m_incomingFilter && m_incomingFilter(msg)) {
+            // ...consumed by the owner
+        } else if (m_nOwnerType == owner::server) {
+            m_qMessagesIn.push_back({this->shared_from_this(), std::move(msg)});
+        } else {
+            m_qMessagesIn.push_back({nullptr, std::move(msg)});
+        }
+        return true;
+    }
+
+    void WakeAll() {
+        futex_wake_all(m_control.state);
+        m_ringIn.wake();
+        m_ringOut.wake();
+    }
+
+    static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    owner m_nOwnerType;
+    shm_segment::control& m_control;
+    shm_ring m_ringOut;
+    shm_ring m_ringIn;
+    shm_options m_options;
+
+    tsqueue<owned_message_type>& m_qMessagesIn;
+    std::function<bool(message<T>&)> m_incomingFilter;
+
+    std::mutex m_muxOut;
+    bool m_bReleased = false;
+
+    uint32_t id = 0;
+};
+
+//* client_interface와 같은 모양의 클라이언트. 서버 이름으로 접속하고, 빈
+//* 채널 (세그먼트)을 찾아 붙는다.
+template <typename T>
+class shm_client_interface {
+ public:
+    using connection_type    = shm_connection<T>;
+    using owned_message_type = typename connection_type::owned_message_type;
+
+    explicit shm_client_interface(const shm_options& options = {})
+        : m_options(options) {}
+
+    virtual ~shm_client_interface() { Disconnect(); }
+
+    // Attach to the first free channel of the named shm server
+    bool Connect(const std::string& name) {
+        for (size_t i = 0;; i++) {
+            auto segment = std::make_unique<shm_segment>();
+            if (!segment->open(shm_channel_name(name, i))) {
+                alog::error("[CLIENT] No free channel on ", name);
+                return false;
+            }
+            uint32_t expected = shm_segment::listening;
+            if (segment->ctl()->state.compare_exchange_strong(
+                    expected, shm_segment::attached)) {
+                segment->ctl()->client_pid.store(
+                    static_cast<uint32_t>(::getpid()),
+                    std::memory_order_release);
+                m_segment = std::move(segment);
+                break;
+            }
+        }
+        futex_wake_all(m_segment->ctl()->state);
+
+        m_connection = std::make_shared<connection_type>(
+            connection_type::owner::client, *m_segment, m_options,
+            m_qMessagesIn);
+        m_connection->SetIncomingFilter(
+            [this](message<T>& msg) { return OnMessageReceived(msg); });
+
+        m_thread = std::thread([this]() {
+            m_connection->ReadLoop();
+            // Let the server reuse the channel, unless it has already given
+            // up on us and handed it to someone else
+            uint32_t expected = shm_segment::closed;
+            if (m_segment->ctl()->state.compare_exchange_strong(
+                    expected, shm_segment::released)) {
+                futex_wake_all(m_segment->ctl()->state);
+            }
+        });
+        return true;
+    }
+
+    void Disconnect() {
+        if (m_connection) {
+            m_connection->Disconnect();
+        }
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        m_connection.reset();
+        m_segment.reset();
+    }
+
+    bool IsConnected() { return m_connection && m_connection->IsConnected(); }
+
+    bool Send(const message<T>& msg) {
+        if (IsConnected()) {
+            m_connection->Send(msg);
+            return true;
+        }
+        return false;
+    }
+
+    tsqueue<owned_message_type>& Incoming() { return m_qMessagesIn; }
+
+ protected:
+    // CLIENT THREAD - See client_interface::OnMessageReceived()
+    virtual bool OnMessageReceived(message<T>& msg) { return false; }
+
+ private:
+    shm_options m_options;
+    std::unique_ptr<shm_segment> m_segment;
+    std::shared_ptr<connection_type> m_connection;
+    std::thread m_thread;
+    tsqueue<owned_message_type> m_qMessagesIn;
+};
+
+//* server_interface와 같은 모양의 서버. 채널마다 세그먼트 하나와 스레드
+//* 하나가 있고, 채널 하나에는 한번에 클라이언트 하나가 붙는다. 채널 스레드가
+//* 접속을 기다리고, 접속한 클라이언트의 메세지를 읽고, 끊어지면 링을 비우고
+//* 다음 클라이언트를 기다린다.
+//* 소켓과 달리 상대 프로세스가 죽어도 커널이 알려주지 않으므로, 링이 비어
+//* 있는 동안 제어 블록에 적힌 상대의 pid가 살아 있는지 주기적으로 확인하고
+//* 죽었으면 채널을 비운다.
+template <typename T>
+class shm_server_interface {
+ public:
+    using connection_type    = shm_connection<T>;
+    using owned_message_type = typename connection_type::owned_message_type;
+
+    explicit shm_server_interface(std::string name, size_t nChannels = 1,
+                                  const shm_options& options = {})
+        : m_sName(std::move(name)),
+          m_nChannels(std::max<size_t>(1, nChannels)),
+          m_options(options) {}
+
+    virtual ~shm_server_interface() { Stop(); }
+
+    bool Start() {
+        for (size_t i = 0; i < m_nChannels; i++) {
+            auto ch = std::make_unique<channel>();
+            if (!ch->segment.create(shm_channel_name(m_sName, i),
+                                    m_options.ring_bytes)) {
+                alog::error("[SERVER] Exception: cannot create shared memory ",
+                            shm_channel_name(m_sName, i));
+                m_vecChannels.clear();
+                return false;
+            }
+            m_vecChannels.push_back(std::move(ch));
+        }
+
+        m_bRunning = true;
+        for (auto& ch : m_vecChannels) {
+            ch->thread =
+                std::thread([this, c = ch.get()]() { RunChannel(*c); });
+        }
+
+        alog::info("[SERVER] Started!");
+        return true;
+    }
+
+    void Stop() {
+        if (!m_bRunning.exchange(false)) {
+            return;
+        }
+        for (auto& ch : m_vecChannels) {
+            {
+                std::scoped_lock lock(ch->mux);
+                if (ch->connection) {
+                    ch->connection->Disconnect();
+                }
+            }
+            futex_wake_all(ch->segment.ctl()->state);
+        }
+        for (auto& ch : m_vecChannels) {
+            ch->thread.join();
+        }
+        m_vecChannels.clear();
+
+        alog::info("[SERVER] Stopped!");
+    }
+
+    void MessageClient(std::shared_ptr<connection_type> client,
+                       const message<T>& msg) {
+        if (client && client->IsConnected()) {
+            client->Send(msg);
+        }
+    }
+
+    void MessageAllClients(
+        const message<T>& msg,
+        std::shared_ptr<connection_type> pIgnoreClient = nullptr) {
+        for (auto& ch : m_vecChannels) {
+            std::shared_ptr<connection_type> client;
+            {
+                std::scoped_lock lock(ch->mux);
+                client = ch->connection;
+            }
+            if (client && client != pIgnoreClient) {
+                MessageClient(client, msg);
+            }
+        }
+    }
+
+    // See server_interface::Update()
+    void Update(size_t nMaxMessages = -1, bool bWait = false) {
+        if (bWait) {
+            m_qMessagesIn.wait();
+        }
+
+        size_t nMessageCount = 0;
+        while (nMessageCount < nMaxMessages && !m_qMessagesIn.empty()) {
+            auto msg = m_qMessagesIn.pop_front();
+            OnMessage(msg.remote, msg.msg);
+            nMessageCount++;
+        }
+    }
+
+ protected:
+    // CHANNEL THREAD - Called when a client attaches, veto it by returning
+    // false
+    virtual bool OnClientConnect(std::shared_ptr<connection_type> client) {
+        return false;
+    }
+
+    // CHANNEL THREAD
+    virtual void OnClientDisconnect(std::shared_ptr<connection_type> client) {}
+
+    // UPDATE THREAD
+    virtual void OnMessage(std::shared_ptr<connection_type> client,
+                           message<T>& msg) {}
+
+    tsqueue<owned_message_type> m_qMessagesIn;
+
+ private:
+    struct channel {
+        shm_segment segment;
+        std::mutex mux;
+        std::shared_ptr<connection_type> connection;
+        std::thread thread;
+    };
+
+    // CHANNEL THREAD
+    void RunChannel(channel& ch) {
+        std::atomic<uint32_t>& state = ch.segment.ctl()->state;
+        while (m_bRunning) {
+            uint32_t s = state.load(std::memory_order_acquire);
+            if (s == shm_segment::listening) {
+                futex_wait(state, s, std::chrono::milliseconds(100));
+                continue;
+            }
+
+            if (s == shm_segment::attached) {
+                ServeClient(ch);
+            }
+            if (!WaitForRelease(*ch.segment.ctl())) {
+                break;
+            }
+
+            // Nobody touches the rings now, ready for the next client
+            ch.segment.ring(0).reset();
+            ch.segment.ring(1).reset();
+            ch.segment.ctl()->client_pid.store(0, std::memory_order_relaxed);
+            state.store(shm_segment::listening, std::memory_order_release);
+        }
+    }
+
+    void ServeClient(channel& ch) {
+        auto client = std::make_shared<connection_type>(
+            connection_type::owner::server, ch.segment, m_options,
+            m_qMessagesIn);
+        if (!OnClientConnect(client)) {
+            alog::info("[-----] Connection Denied");
+            client->Disconnect();
+            client->ReadLoop();
+            return;
+        }
+
+        uint32_t nID = m_nIDCounter++;
+        alog::info("[", nID, "] Connection Approved");
+        {
+            std::scoped_lock lock(ch.mux);
+            ch.connection = client;
+        }
+        client->ReadLoop(nID);
+        {
+            std::scoped_lock lock(ch.mux);
+            ch.connection.reset();
+        }
+        OnClientDisconnect(client);
+    }
+
+    // The client leaves its rings alone once its reader has stopped. A client
+    // that does not answer still owns the rings while its process lives, so
+    // they are only reused once it releases them or is gone. A client that
+    // never got to write its pid counts as gone after a second. False if the
+    // server stops meanwhile.
+    bool WaitForRelease(shm_segment::control& ctl) {
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        for (;;) {
+            uint32_t s = ctl.state.load(std::memory_order_acquire);
+            if (s == shm_segment::released) {
+                return true;
+            }
+            uint32_t pid = ctl.client_pid.load(std::memory_order_acquire);
+            if (pid == 0 ? std::chrono::steady_clock::now() >= deadline
+                         : !process_alive(pid)) {
+                return true;
+            }
+            if (!m_bRunning) {
+                return false;
+            }
+            futex_wait(ctl.state, s, std::chrono::milliseconds(10));
+        }
+    }
+
+    std::string m_sName;
+    size_t m_nChannels;
+    shm_options m_options;
+
+    std::vector<std::unique_ptr<channel>> m_vecChannels;
+    std::atomic<bool> m_bRunning{false};
+    std::atomic<uint32_t> m_nIDCounter{10000};
+};
+
+}  // namespace olc::net
+
+#endif  // __linux__
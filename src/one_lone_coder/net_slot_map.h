@@ -0,0 +1,129 @@
+/**
+ * @file net_slot_map.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 세대(generation) 번호를 가진 slot map. O(1) 조회/삭제와 조밀한 순회
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace olc::net {
+
+//* 값은 조밀한 배열 (dense)에 연속으로 저장하므로 전체 순회가 빠르고,
+//* 키 (handle)는 slot 번호와 그 slot의 세대 번호로 구성된다.
+//*   handle = (generation << SLOT_BITS) | slot
+//* slot 배열 (sparse)이 dense 배열의 위치를 가리키므로 조회는 O(1)이고,
+//* 삭제는 마지막 원소를 빈 자리로 옮기는 swap-and-pop이라 역시 O(1)이다.
+//*
+//* 삭제할 때마다 slot의 세대를 올리므로 삭제된 handle로는 다시 찾을 수 없다.
+//* 세대가 한 바퀴 돌면 같은 handle이 다시 나올 수 있으므로, 그 전에 해당
+//* slot을 더 이상 재사용하지 않는다 (retire). 따라서 handle은 절대로 재사용되지
+//* 않으며, 0은 유효하지 않은 handle이다.
+template <typename V>
+class slot_map {
+ public:
+    using handle_type = uint32_t;
+
+    static constexpr uint32_t SLOT_BITS      = 20;
+    static constexpr uint32_t SLOT_MASK      = (1u << SLOT_BITS) - 1;
+    static constexpr uint32_t MAX_GENERATION = (1u << (32 - SLOT_BITS)) - 1;
+
+    // Insert a value and return its handle, 0 if there is no slot left
+    handle_type insert(V value) {
+        uint32_t slot;
+        if (!m_vecFree.empty()) {
+            slot = m_vecFree.back();
+            m_vecFree.pop_back();
+        } else if (m_vecSparse.size() <= SLOT_MASK) {
+            slot = static_cast<uint32_t>(m_vecSparse.size());
+            m_vecSparse.push_back({1, 0});
+        } else {
+            return 0;
+        }
+
+        m_vecSparse[slot].dense_index =
+            static_cast<uint32_t>(m_vecDense.size());
+        m_vecDense.push_back(std::move(value));
+        m_vecDenseToSlot.push_back(slot);
+        return (m_vecSparse[slot].generation << SLOT_BITS) | slot;
+    }
+
+    // Returns the value of a live handle, nullptr for a stale or unknown one
+    V* find(handle_type handle) {
+        uint32_t slot = handle & SLOT_MASK;
+        if (slot >= m_vecSparse.size() ||
+            m_vecSparse[slot].generation != (handle >> SLOT_BITS) ||
+            m_vecSparse[slot].dense_index == NOT_USED) {
+            return nullptr;
+        }
+        return &m_vecDense[m_vecSparse[slot].dense_index];
+    }
+
+    bool contains(handle_type handle) { return find(handle) != nullptr; }
+
+    // Remove a live handle, returns false for a stale or unknown one
+    bool erase(handle_type handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+        uint32_t slot = handle & SLOT_MASK;
+        uint32_t hole = m_vecSparse[slot].dense_index;
+        uint32_t last = static_cast<uint32_t>(m_vecDense.size()) - 1;
+
+        // Move the last value into the hole and fix up its slot
+        if (hole != last) {
+            m_vecDense[hole]       = std::move(m_vecDense[last]);
+            m_vecDenseToSlot[hole] = m_vecDenseToSlot[last];
+            m_vecSparse[m_vecDenseToSlot[hole]].dense_index = hole;
+        }
+        m_vecDense.pop_back();
+        m_vecDenseToSlot.pop_back();
+
+        m_vecSparse[slot].dense_index = NOT_USED;
+        if (m_vecSparse[slot].generation < MAX_GENERATION) {
+            m_vecSparse[slot].generation++;
+            m_vecFree.push_back(slot);
+        }
+        // ...otherwise the slot is retired, its handles would repeat
+        return true;
+    }
+
+    // Handle of the value at the given dense position
+    handle_type handle_at(size_t dense_index) const {
+        uint32_t slot = m_vecDenseToSlot[dense_index];
+        return (m_vecSparse[slot].generation << SLOT_BITS) | slot;
+    }
+
+    void clear() {
+        while (!m_vecDense.empty()) {
+            erase(handle_at(m_vecDense.size() - 1));
+        }
+    }
+
+    // Dense iteration, no holes
+    auto begin() { return m_vecDense.begin(); }
+    auto end() { return m_vecDense.end(); }
+    size_t size() const { return m_vecDense.size(); }
+    bool empty() const { return m_vecDense.empty(); }
+
+ private:
+    static constexpr uint32_t NOT_USED = UINT32_MAX;
+
+    struct slot_entry {
+        uint32_t generation;
+        uint32_t dense_index;
+    };
+
+    std::vector<slot_entry> m_vecSparse;
+    std::vector<V> m_vecDense;
+    std::vector<uint32_t> m_vecDenseToSlot;
+    std::vector<uint32_t> m_vecFree;
+};
+
+}  // namespace olc::net
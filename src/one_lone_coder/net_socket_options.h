@@ -0,0 +1,209 @@
+/**
+ * @file net_socket_options.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief accept/connect 시점에 소켓에 적용하는 소켓 옵션 정책
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <optional>
+#include <type_traits>
+
+#include "net_common.h"
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace olc::net {
+
+//* asio가 기본으로 제공하지 않는 플랫폼 전용 옵션 (TCP_QUICKACK, SO_BUSY_POLL
+//* 등)을 설정하기 위한 정수형 소켓 옵션. asio의 SettableSocketOption 요구사항을
+//* 만족하므로 socket.set_option()에 그대로 넘길 수 있다.
+template <int Level, int Name>
+class integer_socket_option {
+ public:
+    explicit integer_socket_option(int value) : m_value(value) {}
+
+    template <typename Protocol>
+    int level(const Protocol&) const {
+        return Level;
+    }
+
+    template <typename Protocol>
+    int name(const Protocol&) const {
+        return Name;
+    }
+
+    template <typename Protocol>
+    const int* data(const Protocol&) const {
+        return &m_value;
+    }
+
+    template <typename Protocol>
+    std::size_t size(const Protocol&) const {
+        return sizeof(m_value);
+    }
+
+ private:
+    int m_value;
+};
+
+// Socket options applied to every accepted (server) or connected (client)
+// socket. Unset values leave the operating system default untouched. The TCP
+// only options are skipped on other protocols (e.g. Unix domain sockets).
+struct socket_options {
+    // Disable Nagle, so small messages (like a ping) are sent immediately
+    std::optional<bool> tcp_nodelay = true;
+
+    // SO_SNDBUF / SO_RCVBUF in bytes. TCP settles the window scale in the
+    // handshake, so these go on the socket before connect() or on the
+    // listening socket before listen(), see apply_buffers()
+    std::optional<int> send_buffer_size;
+    std::optional<int> receive_buffer_size;
+
+    // TCP_QUICKACK is not sticky on Linux, so the connection re-arms it after
+    // every read when this is enabled
+    std::optional<bool> tcp_quickack;
+
+    // SO_KEEPALIVE and its timing (TCP_KEEPIDLE/TCP_KEEPINTVL/TCP_KEEPCNT)
+    std::optional<bool> keep_alive;
+    std::optional<int> keepalive_idle_sec;
+    std::optional<int> keepalive_interval_sec;
+    std::optional<int> keepalive_count;
+
+    // SO_BUSY_POLL in microseconds (Linux)
+    std::optional<int> busy_poll_usec;
+
+    // TCP_NOTSENT_LOWAT in bytes
+    std::optional<int> notsent_lowat;
+
+    // Apply the buffer sizes to an open but not yet connected socket, or to
+    // an acceptor before listen() (accepted sockets inherit them). Errors are
+    // reported like apply().
+    template <typename SocketOrAcceptor>
+    asio::error_code apply_buffers(SocketOrAcceptor& socket) const {
+        asio::error_code first;
+        asio::error_code ec;
+        if (send_buffer_size) {
+            socket.set_option(
+                asio::socket_base::send_buffer_size(*send_buffer_size), ec);
+            check("SO_SNDBUF", ec, first);
+        }
+        if (receive_buffer_size) {
+            socket.set_option(
+                asio::socket_base::receive_buffer_size(*receive_buffer_size),
+                ec);
+            check("SO_RCVBUF", ec, first);
+        }
+        return first;
+    }
+
+    // Apply the rest of the policy to a connected socket. A failing option
+    // does not stop the others; the first error is returned so the caller
+    // can decide what to do with it.
+    template <typename Socket>
+    asio::error_code apply(Socket& socket) const {
+        asio::error_code first;
+        auto check = [&first](const char* name, const asio::error_code& ec) {
+            socket_options::check(name, ec, first);
+        };
+        asio::error_code ec;
+
+#if defined(SO_BUSY_POLL)
+        if (busy_poll_usec) {
+            socket.set_option(integer_socket_option<SOL_SOCKET, SO_BUSY_POLL>(
+                                  *busy_poll_usec),
+                              ec);
+            check("SO_BUSY_POLL", ec);
+        }
+#endif
+        // Everything below is TCP only
+        if constexpr (is_tcp<Socket>) {
+            if (tcp_nodelay) {
+                socket.set_option(asio::ip::tcp::no_delay(*tcp_nodelay), ec);
+                check("TCP_NODELAY", ec);
+            }
+            if (keep_alive) {
+                socket.set_option(asio::socket_base::keep_alive(*keep_alive),
+                                  ec);
+                check("SO_KEEPALIVE", ec);
+            }
+#if defined(TCP_KEEPIDLE)
+            if (keepalive_idle_sec) {
+                socket.set_option(
+                    integer_socket_option<IPPROTO_TCP, TCP_KEEPIDLE>(
+                        *keepalive_idle_sec),
+                    ec);
+                check("TCP_KEEPIDLE", ec);
+            }
+#endif
+#if defined(TCP_KEEPINTVL)
+            if (keepalive_interval_sec) {
+                socket.set_option(
+                    integer_socket_option<IPPROTO_TCP, TCP_KEEPINTVL>(
+                        *keepalive_interval_sec),
+                    ec);
+                check("TCP_KEEPINTVL", ec);
+            }
+#endif
+#if defined(TCP_KEEPCNT)
+            if (keepalive_count) {
+                socket.set_option(
+                    integer_socket_option<IPPROTO_TCP, TCP_KEEPCNT>(
+                        *keepalive_count),
+                    ec);
+                check("TCP_KEEPCNT", ec);
+            }
+#endif
+#if defined(TCP_NOTSENT_LOWAT)
+            if (notsent_lowat) {
+                socket.set_option(
+                    integer_socket_option<IPPROTO_TCP, TCP_NOTSENT_LOWAT>(
+                        *notsent_lowat),
+                    ec);
+                check("TCP_NOTSENT_LOWAT", ec);
+            }
+#endif
+            rearm_quickack(socket);
+        }
+        return first;
+    }
+
+    // Re-enable TCP_QUICKACK, the kernel clears it again on its own
+    template <typename Socket>
+    void rearm_quickack(Socket& socket) const {
+#if defined(TCP_QUICKACK)
+        if (is_tcp<Socket> && tcp_quickack) {
+            asio::error_code ec;
+            socket.set_option(
+                integer_socket_option<IPPROTO_TCP, TCP_QUICKACK>(*tcp_quickack),
+                ec);
+        }
+#else
+        (void)socket;
+#endif
+    }
+
+ private:
+    static void check(const char* name, const asio::error_code& ec,
+                      asio::error_code& first) {
+        if (ec) {
+            alog::warn("[SOCKET] Failed to set ", name, ": ", ec.message());
+            if (!first) {
+                first = ec;
+            }
+        }
+    }
+
+    template <typename Socket>
+    static constexpr bool is_tcp =
+        std::is_same_v<typename Socket::protocol_type, asio::ip::tcp>;
+};
+
+}  // namespace olc::net
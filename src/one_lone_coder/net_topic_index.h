@@ -0,0 +1,125 @@
+/**
+ * @file net_topic_index.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief topic -> 구독자 목록 역색인 (publish/subscribe 라우팅)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace olc::net {
+
+//* topic마다 구독자를 조밀한 배열에 저장하므로 publish 비용은 해당 topic의
+//* 구독자 수에만 비례한다. 구독자 ID -> 배열 위치 색인을 함께 유지하므로
+//* 구독 해지는 swap-and-pop으로 O(1)이다. 또 구독자마다 자신이 구독한 topic
+//* 목록을 가지고 있어서, 연결이 끊긴 구독자를 모든 topic에서 빼는 비용은
+//* 그 구독자가 구독한 topic 수에 비례한다.
+//*
+//* Subscriber는 GetID()를 가진 포인터 (예: std::shared_ptr<connection<T>>)
+//* 이다. 잠금은 하지 않으므로 사용하는 쪽에서 동기화해야 한다.
+template <typename Subscriber>
+class topic_index {
+ public:
+    // Returns false if the subscriber is already on the topic
+    bool subscribe(const std::string& topic, const Subscriber& subscriber) {
+        auto& t      = m_mapTopics[topic];
+        uint32_t nID = subscriber->GetID();
+        if (!t.position.emplace(nID, t.members.size()).second) {
+            return false;
+        }
+        t.members.push_back(subscriber);
+        m_mapSubscriptions[nID].push_back(topic);
+        return true;
+    }
+
+    // Returns false if the subscriber was not on the topic
+    bool unsubscribe(const std::string& topic, uint32_t nID) {
+        if (!remove_member(topic, nID)) {
+            return false;
+        }
+        auto it = m_mapSubscriptions.find(nID);
+        if (it != m_mapSubscriptions.end()) {
+            auto& topics = it->second;
+            for (size_t i = 0; i < topics.size(); i++) {
+                if (topics[i] == topic) {
+                    topics[i] = std::move(topics.back());
+                    topics.pop_back();
+                    break;
+                }
+            }
+            if (topics.empty()) {
+                m_mapSubscriptions.erase(it);
+            }
+        }
+        return true;
+    }
+
+    // Take the subscriber off every topic it is on
+    void unsubscribe_all(uint32_t nID) {
+        auto it = m_mapSubscriptions.find(nID);
+        if (it == m_mapSubscriptions.end()) {
+            return;
+        }
+        for (const auto& topic : it->second) {
+            remove_member(topic, nID);
+        }
+        m_mapSubscriptions.erase(it);
+    }
+
+    // Dense list of the subscribers of a topic, nullptr for an unknown topic
+    const std::vector<Subscriber>* subscribers(const std::string& topic) const {
+        auto it = m_mapTopics.find(topic);
+        return it != m_mapTopics.end() ? &it->second.members : nullptr;
+    }
+
+    size_t topic_count() const { return m_mapTopics.size(); }
+
+    void clear() {
+        m_mapTopics.clear();
+        m_mapSubscriptions.clear();
+    }
+
+ private:
+    struct topic_entry {
+        std::vector<Subscriber> members;
+        std::unordered_map<uint32_t, size_t> position;
+    };
+
+    bool remove_member(const std::string& topic, uint32_t nID) {
+        auto it = m_mapTopics.find(topic);
+        if (it == m_mapTopics.end()) {
+            return false;
+        }
+        auto& t    = it->second;
+        auto itPos = t.position.find(nID);
+        if (itPos == t.position.end()) {
+            return false;
+        }
+
+        // Move the last member into the hole and fix up its position
+        size_t hole = itPos->second;
+        t.position.erase(itPos);
+        if (hole != t.members.size() - 1) {
+            t.members[hole] = std::move(t.members.back());
+            t.position[t.members[hole]->GetID()] = hole;
+        }
+        t.members.pop_back();
+
+        // Nobody left, drop the topic itself
+        if (t.members.empty()) {
+            m_mapTopics.erase(it);
+        }
+        return true;
+    }
+
+    std::unordered_map<std::string, topic_entry> m_mapTopics;
+    std::unordered_map<uint32_t, std::vector<std::string>> m_mapSubscriptions;
+};
+
+}  // namespace olc::net
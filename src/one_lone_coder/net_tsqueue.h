@@ -89,14 +89,27 @@ class tsqueue {
     void wait() {
         while (empty()) {
             std::unique_lock<std::mutex> ul(muxBlocking);
+            if (bWoken) {
+                bWoken = false;
+                return;
+            }
             cvBlocking.wait(ul);
         }
     }
 
+    // Let the wait() in progress, or else the next one, return even though
+    // the queue is empty
+    void wake() {
+        std::unique_lock<std::mutex> ul(muxBlocking);
+        bWoken = true;
+        cvBlocking.notify_all();
+    }
+
  protected:
     std::mutex muxQueue;
     std::deque<T> deqQueue;
     std::condition_variable cvBlocking;
     std::mutex muxBlocking;
+    bool bWoken = false;
 };
 }  // namespace olc::net
\ No newline at end of file
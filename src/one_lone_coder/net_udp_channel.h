@@ -0,0 +1,288 @@
+/**
+ * @file net_udp_channel.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief TCP 연결 옆의 unreliable UDP 채널 (sequencing, 조각화, latest-wins)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <asio.hpp>
+
+#include "net_message.h"
+
+namespace olc::net {
+
+// A message from the server with this correlation id carries the UDP token of
+// the connection in its body. It never reaches Incoming(), and rpc_client
+// never hands it out.
+constexpr uint32_t UDP_TOKEN_CORRELATION_ID = 0xffffffff;
+
+//* 모든 datagram 앞에 붙는 헤더. 메세지 하나 (message_header<T> + body)를
+//* mtu 크기의 조각으로 나누고, 조각마다 메세지 전체의 sequence와 조각의
+//* 위치를 적는다.
+//*
+//* 협상: 서버는 연결을 받을 때마다 추측할 수 없는 token을 만들어 TCP로 먼저
+//* 보낸다 (correlation_id가 UDP_TOKEN_CORRELATION_ID인 메세지). 클라이언트는
+//* token을 담은 hello를 서버의 같은 포트 (UDP)로 보내고, 서버는 token으로 TCP
+//* 연결을 찾아 채널을 붙인 뒤 welcome으로 답한다. 보낸 주소는 믿지 않으므로
+//* NAT 뒤에서도 동작하고, 주소가 바뀌면 같은 token의 hello로 다시 붙는다.
+//* welcome을 받기 전까지 클라이언트는 hello를 다시 보내고, unreliable 메세지는
+//* TCP로 간다. data에도 token이 있어야 받아들인다.
+struct udp_packet_header {
+    enum kind_type : uint8_t { hello = 0, welcome = 1, data = 2 };
+
+    static constexpr uint32_t MAGIC = 0x4f4c4355;  // "OLCU"
+
+    uint32_t magic    = MAGIC;
+    uint32_t sequence = 0;
+    // The connection's token, handed out over TCP
+    uint64_t token = 0;
+    // Message id for data, unused for hello and welcome
+    uint32_t tag = 0;
+    // Byte range of this fragment within the whole message
+    uint32_t offset = 0;
+    uint32_t total  = 0;
+    uint16_t fragment       = 0;
+    uint16_t fragment_count = 1;
+    uint8_t kind            = data;
+    uint8_t reserved[7]{};
+
+    // Copies the header out of a datagram, false if it is not one of ours
+    static bool parse(const uint8_t* data, size_t n, udp_packet_header& out) {
+        if (n < sizeof(udp_packet_header)) {
+            return false;
+        }
+        std::memcpy(&out, data, sizeof(out));
+        return out.magic == MAGIC;
+    }
+};
+
+//* 한 peer와의 UDP 채널. 보내는 쪽은 연결 전체에 하나씩 증가하는 sequence를
+//* 메세지마다 붙인다. 받는 쪽은 메세지 id 별로 마지막에 전달한 sequence를
+//* 기억하고 그보다 오래된 메세지 (늦게 도착했거나 중복된 것)는 버린다. 즉 같은
+//* id의 메세지는 최신 것만 의미가 있다 (latest-wins). 일부 조각이 사라진
+//* 메세지는 MAX_PARTIAL개까지만 조립 중으로 두고 오래된 것부터 버린다.
+//*
+//* 소켓은 소유하지 않는다 (서버는 모든 클라이언트가 소켓 하나를 공유). 송신은
+//* 소켓의 executor에서, 수신은 소켓을 읽는 스레드에서만 한다.
+template <typename T>
+class udp_channel : public std::enable_shared_from_this<udp_channel<T>> {
+ public:
+    using endpoint_type = asio::ip::udp::endpoint;
+
+    // Larger messages are not worth sending unreliably, they go over TCP
+    static constexpr size_t MAX_FRAGMENTS = 64;
+    static constexpr size_t MAX_PARTIAL   = 8;
+
+    // Every datagram sent carries nToken, the token of the TCP connection
+    udp_channel(asio::ip::udp::socket& socket, endpoint_type remote,
+                size_t nMtu, uint64_t nToken)
+        : m_socket(socket),
+          m_remote(std::move(remote)),
+          m_nMtu(std::max<size_t>(64, nMtu)),
+          m_nToken(nToken) {}
+
+    const endpoint_type& remote() const { return m_remote; }
+    uint64_t token() const { return m_nToken; }
+
+    // Messages dropped as stale, duplicate or incomplete so far
+    size_t dropped() const { return m_nDropped; }
+
+    // Any thread. Returns false if the message needs too many fragments.
+    bool send(const message<T>& msg) {
+        message_header<T> header = msg.header;
+        header.size = static_cast<uint32_t>(msg.body.size());
+        size_t nTotal = sizeof(header) + msg.body.size();
+        size_t nCount = (nTotal + m_nMtu - 1) / m_nMtu;
+        if (nCount > MAX_FRAGMENTS) {
+            return false;
+        }
+
+        // All datagrams of the message in one buffer, each one
+        // [udp_packet_header][up to mtu bytes of header + body]
+        auto buffer = std::make_shared<std::vector<uint8_t>>(
+            nCount * sizeof(udp_packet_header) + nTotal);
+        udp_packet_header packet;
+        packet.sequence       = m_nNextSequence.fetch_add(1);
+        packet.token          = m_nToken;
+        packet.tag            = static_cast<uint32_t>(msg.header.id);
+        packet.total          = static_cast<uint32_t>(nTotal);
+        packet.fragment_count = static_cast<uint16_t>(nCount);
+
+        std::vector<size_t> vecSizes;
+        uint8_t* out = buffer->data();
+        for (size_t i = 0; i < nCount; i++) {
+            size_t offset = i * m_nMtu;
+            size_t n      = std::min(m_nMtu, nTotal - offset);
+            packet.offset   = static_cast<uint32_t>(offset);
+            packet.fragment = static_cast<uint16_t>(i);
+            std::memcpy(out, &packet, sizeof(packet));
+            CopyPayload(out + sizeof(packet), offset, n, header, msg.body);
+            out += sizeof(packet) + n;
+            vecSizes.push_back(sizeof(packet) + n);
+        }
+
+        asio::post(m_socket.get_executor(),
+                   [self = this->shared_from_this(), buffer,
+                    vecSizes = std::move(vecSizes)]() {
+                       const uint8_t* p = buffer->data();
+                       for (size_t n : vecSizes) {
+                           self->m_socket.async_send_to(
+                               asio::buffer(p, n), self->m_remote,
+                               [buffer](std::error_code, std::size_t) {});
+                           p += n;
+                       }
+                   });
+        return true;
+    }
+
+    // Any thread - hello or welcome
+    void send_control(udp_packet_header::kind_type kind) {
+        auto packet   = std::make_shared<udp_packet_header>();
+        packet->kind  = kind;
+        packet->token = m_nToken;
+        asio::post(m_socket.get_executor(),
+                   [self = this->shared_from_this(), packet]() {
+                       self->m_socket.async_send_to(
+                           asio::buffer(packet.get(), sizeof(*packet)),
+                           self->m_remote,
+                           [packet](std::error_code, std::size_t) {});
+                   });
+    }
+
+    // RECEIVING THREAD - Feed one data datagram. Returns the message once all
+    // of its fragments are in, unless a newer one of the same id got there
+    // first.
+    std::optional<message<T>> receive(const udp_packet_header& packet,
+                                      const uint8_t* payload, size_t n) {
+        if (packet.fragment >= packet.fragment_count ||
+            packet.fragment_count > MAX_FRAGMENTS ||
+            packet.total < sizeof(message_header<T>) ||
+            packet.offset + n > packet.total || IsStale(packet)) {
+            m_nDropped++;
+            return std::nullopt;
+        }
+
+        if (packet.fragment_count == 1) {
+            if (n != packet.total) {
+                m_nDropped++;
+                return std::nullopt;
+            }
+            return Complete(packet, payload);
+        }
+
+        auto it = m_mapPartial.find(packet.sequence);
+        if (it == m_mapPartial.end()) {
+            if (m_mapPartial.size() >= MAX_PARTIAL) {
+                m_mapPartial.erase(m_mapPartial.begin());
+                m_nDropped++;
+            }
+            partial p;
+            p.tag = packet.tag;
+            p.vecReceived.assign(packet.fragment_count, false);
+            p.bytes.resize(packet.total);
+            it = m_mapPartial.emplace(packet.sequence, std::move(p)).first;
+        }
+
+        partial& p = it->second;
+        if (p.bytes.size() != packet.total ||
+            p.vecReceived.size() != packet.fragment_count ||
+            p.vecReceived[packet.fragment]) {
+            return std::nullopt;
+        }
+        p.vecReceived[packet.fragment] = true;
+        std::memcpy(p.bytes.data() + packet.offset, payload, n);
+        if (++p.nReceived < packet.fragment_count) {
+            return std::nullopt;
+        }
+
+        std::vector<uint8_t> bytes = std::move(p.bytes);
+        m_mapPartial.erase(it);
+        return Complete(packet, bytes.data());
+    }
+
+ private:
+    struct partial {
+        uint32_t tag = 0;
+        size_t nReceived = 0;
+        std::vector<bool> vecReceived;
+        std::vector<uint8_t> bytes;
+    };
+
+    // Sequence numbers wrap, compare them as serial numbers
+    static bool IsNewer(uint32_t a, uint32_t b) {
+        return static_cast<int32_t>(a - b) > 0;
+    }
+
+    bool IsStale(const udp_packet_header& packet) const {
+        auto it = m_mapLatest.find(packet.tag);
+        return it != m_mapLatest.end() && !IsNewer(packet.sequence, it->second);
+    }
+
+    std::optional<message<T>> Complete(const udp_packet_header& packet,
+                                       const uint8_t* bytes) {
+        message<T> msg;
+        std::memcpy(&msg.header, bytes, sizeof(msg.header));
+        if (msg.header.size != packet.total - sizeof(msg.header)) {
+            m_nDropped++;
+            return std::nullopt;
+        }
+        msg.body.assign(bytes + sizeof(msg.header), bytes + packet.total);
+        m_mapLatest[packet.tag] = packet.sequence;
+
+        // Older messages of the same id still being assembled are stale now
+        for (auto it = m_mapPartial.begin(); it != m_mapPartial.end();) {
+            if (it->second.tag == packet.tag &&
+                !IsNewer(it->first, packet.sequence)) {
+                it = m_mapPartial.erase(it);
+                m_nDropped++;
+            } else {
+                ++it;
+            }
+        }
+        return msg;
+    }
+
+    // Copy [offset, offset + n) of the message header followed by the body
+    static void CopyPayload(uint8_t* out, size_t offset, size_t n,
+                            const message_header<T>& header,
+                            const std::vector<uint8_t>& body) {
+        const auto* h = reinterpret_cast<const uint8_t*>(&header);
+        if (offset < sizeof(header)) {
+            size_t k = std::min(n, sizeof(header) - offset);
+            std::memcpy(out, h + offset, k);
+            out += k;
+            offset += k;
+            n -= k;
+        }
+        if (n > 0) {
+            std::memcpy(out, body.data() + (offset - sizeof(header)), n);
+        }
+    }
+
+    asio::ip::udp::socket& m_socket;
+    endpoint_type m_remote;
+    size_t m_nMtu;
+    uint64_t m_nToken;
+
+    std::atomic<uint32_t> m_nNextSequence{1};
+
+    // Receiving side, only touched on the thread that reads the socket
+    std::unordered_map<uint32_t, uint32_t> m_mapLatest;
+    std::map<uint32_t, partial> m_mapPartial;
+    size_t m_nDropped = 0;
+};
+
+}  // namespace olc::net
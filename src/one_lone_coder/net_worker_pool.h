@@ -0,0 +1,211 @@
+/**
+ * @file net_worker_pool.h
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief 메세지 핸들러 실행용 work-stealing 스레드 풀과 클라이언트 별 직렬 큐
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace olc::net {
+
+//* 워커마다 자신의 작업 큐를 가진다. 워커는 자신의 큐 앞에서 작업을 꺼내고,
+//* 비어 있으면 다른 워커 큐의 뒤에서 작업을 훔쳐온다 (work stealing).
+//* 워커 스레드 안에서 post()한 작업은 그 워커의 큐로, 바깥에서 post()한
+//* 작업은 round-robin으로 나눠 넣는다. 큐 마다 잠금이 따로 있으므로 풀 전체를
+//* 막는 잠금은 없다.
+class worker_pool {
+ public:
+    explicit worker_pool(size_t nThreads) {
+        nThreads = std::max<size_t>(1, nThreads);
+        for (size_t i = 0; i < nThreads; i++) {
+            m_vecQueues.push_back(std::make_unique<task_queue>());
+        }
+        for (size_t i = 0; i < nThreads; i++) {
+            m_vecThreads.emplace_back([this, i]() { Run(i); });
+        }
+    }
+
+    worker_pool(const worker_pool&) = delete;
+
+    // Tasks that have not started yet are discarded, running ones are waited
+    // for. Tasks they post meanwhile are discarded too.
+    ~worker_pool() {
+        {
+            std::scoped_lock lock(m_muxIdle);
+            m_bStop = true;
+        }
+        for (auto& queue : m_vecQueues) {
+            std::deque<std::function<void()>> tasks;
+            {
+                std::scoped_lock lock(queue->mux);
+                tasks.swap(queue->tasks);
+            }
+            m_nQueued.fetch_sub(tasks.size(), std::memory_order_relaxed);
+        }
+        m_cvIdle.notify_all();
+        for (auto& thread : m_vecThreads) {
+            thread.join();
+        }
+    }
+
+    void post(std::function<void()> task) {
+        size_t index;
+        if (tls_pool == this) {
+            index = tls_index;
+        } else {
+            index = m_nNext.fetch_add(1, std::memory_order_relaxed) %
+                    m_vecQueues.size();
+        }
+        {
+            std::scoped_lock lock(m_vecQueues[index]->mux);
+            m_vecQueues[index]->tasks.push_back(std::move(task));
+        }
+        m_nQueued.fetch_add(1, std::memory_order_release);
+
+        // Taking the idle lock orders this against a worker that has just
+        // checked m_nQueued and is about to sleep
+        { std::scoped_lock lock(m_muxIdle); }
+        m_cvIdle.notify_one();
+    }
+
+    size_t size() const { return m_vecThreads.size(); }
+
+ private:
+    struct task_queue {
+        std::mutex mux;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Run(size_t index) {
+        tls_pool  = this;
+        tls_index = index;
+
+        std::function<void()> task;
+        while (!m_bStop.load()) {
+            if (TryPop(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock lock(m_muxIdle);
+            m_cvIdle.wait(lock, [this]() {
+                return m_bStop ||
+                       m_nQueued.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    // Own queue first (oldest task), then steal the newest task of another
+    bool TryPop(size_t index, std::function<void()>& task) {
+        for (size_t i = 0; i < m_vecQueues.size(); i++) {
+            task_queue& q = *m_vecQueues[(index + i) % m_vecQueues.size()];
+            std::scoped_lock lock(q.mux);
+            if (q.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            } else {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            }
+            m_nQueued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    static inline thread_local worker_pool* tls_pool = nullptr;
+    static inline thread_local size_t tls_index      = 0;
+
+    std::vector<std::unique_ptr<task_queue>> m_vecQueues;
+    std::vector<std::thread> m_vecThreads;
+    std::atomic<size_t> m_nNext{0};
+    std::atomic<size_t> m_nQueued{0};
+
+    std::mutex m_muxIdle;
+    std::condition_variable m_cvIdle;
+    // Written under m_muxIdle, read by the workers before every task
+    std::atomic<bool> m_bStop{false};
+};
+
+//* 한 클라이언트의 메세지를 순서대로 처리하기 위한 직렬 큐. 큐가 비어 있지
+//* 않은 동안에만 풀에 작업 하나가 등록되어 있으므로 같은 클라이언트의
+//* 메세지가 동시에 처리되는 일은 없다. 한번에 처리하는 메세지 수를 제한해서
+//* 메세지를 쏟아내는 클라이언트가 워커를 독점하지 못하게 한다.
+template <typename Item>
+class serial_queue : public std::enable_shared_from_this<serial_queue<Item>> {
+ public:
+    static constexpr size_t BATCH = 16;
+
+    serial_queue(worker_pool& pool, std::function<void(Item&)> handler)
+        : m_pool(pool), m_handler(std::move(handler)) {}
+
+    void push(Item item) {
+        bool bSchedule;
+        {
+            std::scoped_lock lock(m_mux);
+            m_deqItems.push_back(std::move(item));
+            bSchedule    = !m_bScheduled;
+            m_bScheduled = true;
+        }
+        if (bSchedule) {
+            Schedule();
+        }
+    }
+
+    // True if nothing is queued or running
+    bool idle() {
+        std::scoped_lock lock(m_mux);
+        return !m_bScheduled;
+    }
+
+ private:
+    void Schedule() {
+        m_pool.post([self = this->shared_from_this()]() { self->Drain(); });
+    }
+
+    // WORKER THREAD
+    void Drain() {
+        for (size_t n = 0; n < BATCH; n++) {
+            Item item;
+            {
+                std::scoped_lock lock(m_mux);
+                if (m_deqItems.empty()) {
+                    m_bScheduled = false;
+                    return;
+                }
+                item = std::move(m_deqItems.front());
+                m_deqItems.pop_front();
+            }
+            m_handler(item);
+        }
+
+        // Still scheduled, so nobody else runs this queue meanwhile
+        Schedule();
+    }
+
+    worker_pool& m_pool;
+    std::function<void(Item&)> m_handler;
+
+    std::mutex m_mux;
+    std::deque<Item> m_deqItems;
+    bool m_bScheduled = false;
+};
+
+}  // namespace olc::net
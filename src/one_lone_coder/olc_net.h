@@ -10,9 +10,18 @@
  */
 #pragma once
 
+#include "net_capture.h"
 #include "net_client.h"
 #include "net_common.h"
 #include "net_connection.h"
 #include "net_message.h"
+#include "net_rate_limit.h"
+#include "net_rpc.h"
 #include "net_server.h"
-#include "net_tsqueue.h"
\ No newline at end of file
+#include "net_shm_transport.h"
+#include "net_slot_map.h"
+#include "net_socket_options.h"
+#include "net_topic_index.h"
+#include "net_tsqueue.h"
+#include "net_udp_channel.h"
+#include "net_worker_pool.h"
\ No newline at end of file
@@ -0,0 +1,94 @@
+/**
+ * @file rpc_client.cpp
+ * @author Sejong Heo (tromberx@gmail.com)
+ * @brief rpc_client로 하나의 연결에서 여러 요청을 동시에 보내는 예제
+ * (simple_server가 ServerPing을 그대로 돌려보내므로 응답으로 사용한다.)
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <atomic>
+#include <iostream>
+
+#include "olc_net.h"
+
+enum class CustomMsgTypes : uint32_t {
+    ServerAccept,
+    ServerDeny,
+    ServerPing,
+    MessageAll,
+    ServerMessage,
+};
+
+int main() {
+    olc::net::rpc_client<CustomMsgTypes> c;
+    // Wait for the connection to be made, but not forever if the server is
+    // not running
+    auto tDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    bool bConnected = c.Connect("127.0.0.1", 10000);
+    while (bConnected && !c.IsConnected()) {
+        if (std::chrono::steady_clock::now() >= tDeadline) {
+            bConnected = false;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!bConnected) {
+        std::cerr << "Cannot connect to 127.0.0.1:10000\n";
+        return 1;
+    }
+
+    const int nRequests = 1000;
+    auto timeout        = std::chrono::milliseconds(2000);
+
+    //* 1. future: 요청을 모두 보낸 뒤 응답을 기다린다.
+    std::vector<std::future<olc::net::message<CustomMsgTypes>>> futures;
+    auto tStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nRequests; i++) {
+        olc::net::message<CustomMsgTypes> msg;
+        msg.header.id = CustomMsgTypes::ServerPing;
+        msg << i;
+        futures.push_back(c.Call(std::move(msg), timeout));
+    }
+
+    int nOk = 0;
+    for (uint32_t i = 0; i < nRequests; i++) {
+        try {
+            auto reply = futures[i].get();
+            uint32_t value;
+            reply >> value;
+            nOk += (value == i);
+        } catch (asio::system_error& e) {
+            std::cout << "Request " << i << " failed: " << e.what() << "\n";
+        }
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - tStart;
+    std::cout << "future: " << nOk << "/" << nRequests << " replies in "
+              << elapsed.count() << " ms\n";
+
+    //* 2. callback: asio 스레드에서 호출된다. 실패 (timeout 포함)해도 한번은
+    //* 호출된다.
+    std::atomic<int> nDone{0};
+    std::atomic<int> nReplies{0};
+    for (uint32_t i = 0; i < nRequests; i++) {
+        olc::net::message<CustomMsgTypes> msg;
+        msg.header.id = CustomMsgTypes::ServerPing;
+        c.Call(std::move(msg), timeout,
+               [&nDone, &nReplies](asio::error_code ec,
+                                   olc::net::message<CustomMsgTypes>) {
+                   if (!ec) {
+                       nReplies++;
+                   }
+                   nDone++;
+               });
+    }
+    while (nDone < nRequests) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::cout << "callback: " << nReplies << "/" << nRequests << " replies\n";
+
+    return 0;
+}
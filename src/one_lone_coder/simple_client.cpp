@@ -44,6 +44,9 @@ class CustomClient : public olc::net::client_interface<CustomMsgTypes> {
 
 int main() {
     CustomClient c;
+    // Keep reconnecting (with backoff) if the server goes away, pings sent in
+    // the meantime are delivered once it is back.
+    c.EnableAutoReconnect();
     c.Connect("127.0.0.1", 10000);
 
     int number = 0;
@@ -95,8 +98,7 @@ int main() {
                 }
             }
         } else {
-            std::cout << "Server Down\n";
-            bQuit = true;
+            std::cout << "Server Down, reconnecting...\n";
         }
     }
 
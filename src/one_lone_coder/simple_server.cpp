@@ -8,7 +8,13 @@
  * @copyright Copyright (c) 2022
  * 
  */
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
 
 #include "olc_net.h"
 
@@ -22,8 +28,12 @@ enum class CustomMsgTypes : uint32_t {
 
 class CustomServer : public olc::net::server_interface<CustomMsgTypes> {
  public:
-    CustomServer(uint16_t nPort)
-        : olc::net::server_interface<CustomMsgTypes>(nPort) {}
+    CustomServer(uint16_t nPort, size_t nIoThreads)
+        : olc::net::server_interface<CustomMsgTypes>(
+              nPort, olc::net::socket_options(), nIoThreads) {}
+
+    // The io threads and handlers call back into this object
+    ~CustomServer() override { Stop(); }
 
  protected:
     bool OnClientConnect(
@@ -65,13 +75,77 @@ class CustomServer : public olc::net::server_interface<CustomMsgTypes> {
     }
 };
 
-int main() {
-    CustomServer server(10000);
+int main(int argc, char* argv[]) {
+    // Optional: number of io threads the clients are spread over, and
+    // --capture <file> to record the incoming traffic or
+    // --replay <file> [--speed <x>] to play a recording back in, and
+    // --cpus <list> to pin the io threads
+    size_t nIoThreads = 1;
+    std::string sCapture;
+    std::string sReplay;
+    double fSpeed = 1.0;
+    std::string sCpus;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) {
+            sCapture = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            sReplay = argv[++i];
+        } else if (arg == "--speed" && i + 1 < argc) {
+            fSpeed = std::atof(argv[++i]);
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            sCpus = argv[++i];
+        } else {
+            nIoThreads = std::max(1, std::atoi(argv[i]));
+        }
+    }
+
+    CustomServer server(10000, nIoThreads);
+    // e.g. --cpus 0-3 pins io thread i to cpu i
+    if (!sCpus.empty()) {
+        server.SetIoPlacement({iothreads::parse_cpu_list(sCpus), "olc-io"});
+    }
+#if defined(OLC_NET_HAS_CAPTURE)
+    if (!sCapture.empty()) {
+        server.EnableCapture(sCapture);
+    }
+#endif
     server.Start();
 
-    while (1) {
+    // Replay() returns early once the server has stopped, and is joined
+    // before the server goes away
+    std::thread replayThread;
+#if defined(OLC_NET_HAS_CAPTURE)
+    if (!sReplay.empty()) {
+        replayThread = std::thread([&server, sReplay, fSpeed]() {
+            size_t n = server.Replay(sReplay, fSpeed);
+            std::cout << "[SERVER] Replayed " << n << " messages\n";
+        });
+    }
+#endif
+
+    // Ctrl+C or kill stops the server cleanly, which also completes the
+    // capture
+    std::atomic<bool> bQuit{false};
+    asio::io_context signalContext;
+    asio::signal_set signals(signalContext, SIGINT, SIGTERM);
+    signals.async_wait([&](std::error_code ec, int) {
+        if (!ec) {
+            bQuit = true;
+            server.Wake();
+        }
+    });
+    std::thread signalThread([&]() { signalContext.run(); });
+
+    while (!bQuit) {
         server.Update(-1, true);
     }
+    server.Stop();
+    if (replayThread.joinable()) {
+        replayThread.join();
+    }
 
+    signalContext.stop();
+    signalThread.join();
     return 0;
 }
\ No newline at end of file